@@ -0,0 +1,262 @@
+/// @file bench_compare.cpp
+/// @brief compare a Google Benchmark JSON run against a baseline.
+/// @note usage:
+///   bench_compare <baseline.json> <current.json> [--threshold=<percent>]
+///                 [--alpha=<significance>]
+/// both files should come from `--benchmark_repetitions=<n>` (n >= 5 or so)
+/// and `--benchmark_out_format=json`. For each benchmark the repetitions are
+/// compared with a two-sided Mann-Whitney U test; a benchmark regressed if the
+/// difference is significant at `alpha` (default 0.05) and the median slowed
+/// down by more than `threshold` percent (default 5). The exit code is 1 if
+/// any benchmark regressed, 2 on bad input and 0 otherwise.
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <net/ancillarycat/utils/json.hpp>
+
+namespace {
+namespace json = net::ancillarycat::utils::json;
+using samples_t = std::vector<double>;
+/// @brief real time of every repetition in nanoseconds, by benchmark name.
+using runs_t = std::map<std::string, samples_t, std::less<>>;
+
+auto to_nanoseconds(const std::string_view unit) -> std::optional<double> {
+  if (unit == "ns")
+    return 1;
+  if (unit == "us")
+    return 1e3;
+  if (unit == "ms")
+    return 1e6;
+  if (unit == "s")
+    return 1e9;
+  return std::nullopt;
+}
+
+auto load_runs(const char *path) -> std::optional<runs_t> {
+  auto file = std::ifstream(path, std::ios::binary);
+  if (!file) {
+    std::println(stderr, "cannot open {}", path);
+    return std::nullopt;
+  }
+  auto buffer = std::ostringstream{};
+  buffer << file.rdbuf();
+  const auto document = json::parse(buffer.view());
+  const auto benchmarks = document ? document->find("benchmarks") : nullptr;
+  if (!benchmarks || !benchmarks->is_array()) {
+    std::println(stderr, "{} is not a Google Benchmark JSON file", path);
+    return std::nullopt;
+  }
+  auto runs = runs_t{};
+  for (const auto &benchmark : benchmarks->as_array()) {
+    // skip the mean/median/stddev rows that come with repetitions.
+    if (const auto type = benchmark.find("run_type");
+        type && type->string() != "iteration")
+      continue;
+    auto name_value = benchmark.find("run_name");
+    if (!name_value)
+      name_value = benchmark.find("name");
+    const auto name = name_value ? name_value->string() : std::nullopt;
+    const auto time = benchmark.find("real_time");
+    const auto unit = benchmark.find("time_unit");
+    const auto scale = unit && unit->string()
+                           ? to_nanoseconds(*unit->string())
+                           : std::optional{1.0};
+    if (!name || !time || !time->number() || !scale) {
+      std::println(stderr, "{}: malformed benchmark entry", path);
+      return std::nullopt;
+    }
+    runs[std::string{*name}].push_back(*time->number() * *scale);
+  }
+  return runs;
+}
+
+auto median(samples_t samples) -> double {
+  std::ranges::sort(samples);
+  const auto size = samples.size();
+  return size % 2 ? samples[size / 2]
+                  : (samples[size / 2 - 1] + samples[size / 2]) / 2;
+}
+
+/// @brief two-sided p-value of the Mann-Whitney U test, using the normal
+/// approximation with tie and continuity correction.
+auto mann_whitney_p(const samples_t &lhs, const samples_t &rhs) -> double {
+  struct Ranked {
+    double value;
+    bool from_lhs;
+  };
+  auto all = std::vector<Ranked>{};
+  for (const auto value : lhs)
+    all.push_back({value, true});
+  for (const auto value : rhs)
+    all.push_back({value, false});
+  std::ranges::sort(all, {}, &Ranked::value);
+
+  const auto n1 = static_cast<double>(lhs.size());
+  const auto n2 = static_cast<double>(rhs.size());
+  const auto n = n1 + n2;
+  auto rank_sum = 0.0;
+  auto tie_term = 0.0;
+  for (auto first = std::size_t{}; first < all.size();) {
+    auto last = first;
+    while (last < all.size() && all[last].value == all[first].value)
+      ++last;
+    // ranks are 1-based; tied values share the average rank.
+    const auto rank = static_cast<double>(first + last + 1) / 2;
+    const auto ties = static_cast<double>(last - first);
+    for (auto i = first; i < last; ++i)
+      if (all[i].from_lhs)
+        rank_sum += rank;
+    tie_term += ties * ties * ties - ties;
+    first = last;
+  }
+  const auto u = rank_sum - n1 * (n1 + 1) / 2;
+  const auto mean = n1 * n2 / 2;
+  const auto variance =
+      n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)));
+  if (variance <= 0)
+    return 1;
+  const auto z = std::max(std::abs(u - mean) - 0.5, 0.0) / std::sqrt(variance);
+  return std::erfc(z / std::sqrt(2.0));
+}
+
+/// @brief Hodges-Lehmann estimate of `rhs - lhs` with its distribution-free
+/// confidence interval at level `1 - alpha`.
+struct Shift {
+  double estimate;
+  double lower;
+  double upper;
+};
+auto hodges_lehmann(const samples_t &lhs, const samples_t &rhs,
+                    const double alpha) -> Shift {
+  auto differences = std::vector<double>{};
+  differences.reserve(lhs.size() * rhs.size());
+  for (const auto x : lhs)
+    for (const auto y : rhs)
+      differences.push_back(y - x);
+  std::ranges::sort(differences);
+
+  // the normal quantile, by bisection on erfc; plenty precise for this.
+  auto low = 0.0, high = 10.0;
+  for (auto i = 0; i < 100; ++i) {
+    const auto mid = (low + high) / 2;
+    (std::erfc(mid / std::sqrt(2.0)) > alpha ? low : high) = mid;
+  }
+  const auto n1 = static_cast<double>(lhs.size());
+  const auto n2 = static_cast<double>(rhs.size());
+  const auto count = static_cast<double>(differences.size());
+  const auto k = std::clamp(
+      std::floor(n1 * n2 / 2 - low * std::sqrt(n1 * n2 * (n1 + n2 + 1) / 12)),
+      0.0,
+      count - 1);
+  return {median(differences),
+          differences[static_cast<std::size_t>(k)],
+          differences[static_cast<std::size_t>(count - 1 - k)]};
+}
+
+auto parse_option(const std::string_view arg,
+                  const std::string_view name,
+                  double &value) -> bool {
+  if (!arg.starts_with(name))
+    return false;
+  const auto text = arg.substr(name.size());
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && ptr == text.data() + text.size();
+}
+} // namespace
+
+int main(const int argc, char **argv) {
+  auto threshold = 5.0;
+  auto alpha = 0.05;
+  auto files = std::vector<const char *>{};
+  for (auto i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (arg.starts_with("--")) {
+      if (!parse_option(arg, "--threshold=", threshold) &&
+          !parse_option(arg, "--alpha=", alpha)) {
+        std::println(stderr, "unknown or malformed option: {}", arg);
+        return 2;
+      }
+    } else
+      files.push_back(argv[i]);
+  }
+  if (files.size() != 2) {
+    std::println(stderr,
+                 "usage: {} <baseline.json> <current.json> "
+                 "[--threshold=<percent>] [--alpha=<significance>]",
+                 argv[0]);
+    return 2;
+  }
+  const auto baseline = load_runs(files[0]);
+  const auto current = load_runs(files[1]);
+  if (!baseline || !current)
+    return 2;
+
+  std::println("{:<32}{:>14}{:>14}{:>10}{:>22}{:>10}  {}",
+               "benchmark",
+               "base(ns)",
+               "current(ns)",
+               "change",
+               std::format("{:g}% CI", 100 * (1 - alpha)),
+               "p",
+               "verdict");
+  auto regressions = 0;
+  for (const auto &[name, samples] : *current) {
+    const auto it = baseline->find(name);
+    if (it == baseline->end()) {
+      std::println("{:<32}{:>14}{:>14.1f}  new", name, "-", median(samples));
+      continue;
+    }
+    const auto &base = it->second;
+    const auto base_median = median(base);
+    const auto change = 100 * (median(samples) - base_median) / base_median;
+    if (base.size() < 3 || samples.size() < 3) {
+      std::println("{:<32}{:>14.1f}{:>14.1f}{:>9.1f}%  too few repetitions",
+                   name,
+                   base_median,
+                   median(samples),
+                   change);
+      continue;
+    }
+    const auto p = mann_whitney_p(base, samples);
+    const auto shift = hodges_lehmann(base, samples, alpha);
+    const auto significant = p < alpha;
+    const auto verdict = !significant          ? "same"
+                         : change > threshold  ? "REGRESSION"
+                         : change < -threshold ? "improvement"
+                                               : "same";
+    regressions += significant && change > threshold;
+    std::println("{:<32}{:>14.1f}{:>14.1f}{:>9.1f}%{:>22}{:>10.4f}  {}",
+                 name,
+                 base_median,
+                 median(samples),
+                 change,
+                 std::format("[{:+.1f}%, {:+.1f}%]",
+                             100 * shift.lower / base_median,
+                             100 * shift.upper / base_median),
+                 p,
+                 verdict);
+  }
+  for (const auto &name : *baseline | std::views::keys)
+    if (!current->contains(name))
+      std::println("{:<32}  missing from the current run", name);
+  if (regressions)
+    std::println(stderr,
+                 "{} benchmark(s) regressed by more than {}%",
+                 regressions,
+                 threshold);
+  return regressions ? 1 : 0;
+}
@@ -1,6 +1,8 @@
 #include <benchmark/benchmark.h>
 #include <filesystem>
+#include <string>
 #include "test_env.hpp"
+#include "perf_counters.hpp"
 namespace {
 auto get_result(auto &&filepath) {
   ExecutionContext ec;
@@ -20,17 +22,21 @@ fun fib(n){
 )"s;
 static void BM_Fib(benchmark::State &state) {
   auto i = static_cast<unsigned>(state.range(0));
+  auto perf_counters = PerfCounters::from_env();
   for (auto _ : state) {
-    auto fibCode = fibStr + "print fib(" + fmt::to_string(i) + ");";
+    auto fibCode = fibStr + "print fib(" + std::to_string(i) + ");";
     auto currentPath = current_path();
     auto filePath =
-        currentPath / "fib"s.append(fmt::to_string(i)).append(".lox");
+        currentPath / "fib"s.append(std::to_string(i)).append(".lox");
     std::fstream f = std::fstream(filePath, std::ios::out);
     f << fibCode;
     f.close();
+    perf_counters.resume();
     auto [_2, str] = get_result(filePath);
+    perf_counters.pause();
     std::filesystem::remove(filePath);
   }
+  perf_counters.report(state);
 }
 
 BENCHMARK(BM_Fib)->DenseRange(0, 20);
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  define LOXO_HAS_PERF_EVENT 1
+#else
+#  define LOXO_HAS_PERF_EVENT 0
+#endif
+
+/// @brief hardware counters of the calling thread, reported as Google
+/// Benchmark user counters.
+/// @note opt-in through `LOXO_PERF_COUNTERS=1`, since they are usually not
+/// available in containers or without `perf_event_paranoid <= 2`. Each event
+/// is opened on its own, so an unsupported one is simply left out of the
+/// report; if none can be opened, nothing is reported at all. Counts are
+/// scaled when the kernel had to multiplex the counters.
+class PerfCounters {
+public:
+  /// @brief disabled unless `LOXO_PERF_COUNTERS` is set to something other
+  /// than `0`.
+  static auto from_env() -> PerfCounters {
+    const auto value = std::getenv("LOXO_PERF_COUNTERS");
+    return PerfCounters{value && std::string_view{value} != "0"};
+  }
+  explicit PerfCounters(const bool enabled) {
+    if (enabled)
+      open();
+  }
+  PerfCounters(const PerfCounters &) = delete;
+  auto operator=(const PerfCounters &) = delete;
+  PerfCounters(PerfCounters &&that) noexcept
+      : counters(std::exchange(that.counters, {})) {}
+  auto operator=(PerfCounters &&) = delete;
+  ~PerfCounters() { close(); }
+
+public:
+  /// @brief start (or continue) counting; pair with @link pause @endlink
+  /// around the code under measurement.
+  void resume() noexcept { ioctl_all(enable_request()); }
+  void pause() noexcept { ioctl_all(disable_request()); }
+  /// @brief adds the counters, averaged per iteration, and the IPC.
+  void report(benchmark::State &state) const {
+    auto cycles = 0.0;
+    auto instructions = 0.0;
+    for (const auto &counter : counters) {
+      if (counter.fd < 0)
+        continue;
+      const auto value = read(counter.fd);
+      state.counters[counter.name.data()] =
+          benchmark::Counter(value, benchmark::Counter::kAvgIterations);
+      if (counter.name == "cycles")
+        cycles = value;
+      else if (counter.name == "instructions")
+        instructions = value;
+    }
+    if (cycles > 0 && instructions > 0)
+      state.counters["IPC"] = instructions / cycles;
+  }
+
+private:
+  struct Counter {
+    std::string_view name;
+    std::uint32_t type;
+    std::uint64_t config;
+    int fd = -1;
+  };
+#if LOXO_HAS_PERF_EVENT
+  /// @brief read misses of @p cache, see `man perf_event_open`.
+  static constexpr auto miss(const std::uint64_t cache) -> std::uint64_t {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+  std::array<Counter, 6> counters{{
+      {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {"L1d-misses", PERF_TYPE_HW_CACHE, miss(PERF_COUNT_HW_CACHE_L1D)},
+      {"LLC-misses", PERF_TYPE_HW_CACHE, miss(PERF_COUNT_HW_CACHE_LL)},
+      {"dTLB-misses", PERF_TYPE_HW_CACHE, miss(PERF_COUNT_HW_CACHE_DTLB)},
+  }};
+
+  static auto enable_request() noexcept -> unsigned long {
+    return PERF_EVENT_IOC_ENABLE;
+  }
+  static auto disable_request() noexcept -> unsigned long {
+    return PERF_EVENT_IOC_DISABLE;
+  }
+  void open() noexcept {
+    for (auto &counter : counters) {
+      auto attr = perf_event_attr{};
+      attr.size = sizeof attr;
+      attr.type = counter.type;
+      attr.config = counter.config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      counter.fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if (counter.fd >= 0)
+        ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+    }
+  }
+  void close() noexcept {
+    for (auto &counter : counters)
+      if (counter.fd >= 0)
+        ::close(std::exchange(counter.fd, -1));
+  }
+  void ioctl_all(const unsigned long request) noexcept {
+    for (const auto &counter : counters)
+      if (counter.fd >= 0)
+        ioctl(counter.fd, request, 0);
+  }
+  static auto read(const int fd) noexcept -> double {
+    // value, time enabled, time running
+    auto values = std::array<std::uint64_t, 3>{};
+    if (::read(fd, values.data(), sizeof values) != sizeof values ||
+        values[2] == 0)
+      return 0;
+    return static_cast<double>(values[0]) * static_cast<double>(values[1]) /
+           static_cast<double>(values[2]);
+  }
+#else
+  std::array<Counter, 0> counters{};
+
+  static auto enable_request() noexcept -> unsigned long { return 0; }
+  static auto disable_request() noexcept -> unsigned long { return 0; }
+  void open() noexcept {}
+  void close() noexcept {}
+  void ioctl_all(unsigned long) noexcept {}
+  static auto read(int) noexcept -> double { return 0; }
+#endif
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/// @brief deterministic generator of large Lox scripts for the throughput and
+/// scaling benchmarks.
+/// @note the same shape, size and seed always produce the same script on every
+/// platform: the generator uses its own PRNG instead of the unspecified
+/// `std::*_distribution`s.
+namespace workload {
+/// @brief what a generated script mostly consists of.
+enum class Shape : std::uint8_t {
+  /// blocks nested @link Options::max_depth @endlink deep, with the innermost
+  /// one reading a variable of the outermost; stresses the environment chain.
+  kNestedScopes,
+  /// many global functions, each called from a later statement.
+  kManyFunctions,
+  /// `var` initializers made of long chains of binary operators.
+  kExpressionChains,
+  /// string literals of up to a few KiB, concatenated with earlier ones.
+  kStringLiterals,
+  /// closures capturing a counter, created and called repeatedly.
+  kClosures,
+  /// all of the above, interleaved at random.
+  kMixed,
+};
+inline constexpr auto kShapes = std::array{Shape::kNestedScopes,
+                                           Shape::kManyFunctions,
+                                           Shape::kExpressionChains,
+                                           Shape::kStringLiterals,
+                                           Shape::kClosures,
+                                           Shape::kMixed};
+
+inline constexpr auto shape_name(const Shape shape) -> std::string_view {
+  switch (shape) {
+  case Shape::kNestedScopes:
+    return "nested_scopes";
+  case Shape::kManyFunctions:
+    return "many_functions";
+  case Shape::kExpressionChains:
+    return "expression_chains";
+  case Shape::kStringLiterals:
+    return "string_literals";
+  case Shape::kClosures:
+    return "closures";
+  case Shape::kMixed:
+    return "mixed";
+  }
+  return "unknown";
+}
+inline constexpr auto parse_shape(const std::string_view name)
+    -> std::optional<Shape> {
+  for (const auto shape : kShapes)
+    if (shape_name(shape) == name)
+      return shape;
+  return std::nullopt;
+}
+
+struct Options {
+  Shape shape = Shape::kMixed;
+  /// @brief number of top-level units (a nest, a function, a chain...) to
+  /// emit; the script grows linearly with it.
+  std::size_t size = 64;
+  std::uint64_t seed = 0x10c5eed;
+  /// @brief the deepest nest @link Shape::kNestedScopes @endlink emits; bigger
+  /// sizes emit more nests instead, so that the recursive descent parser and
+  /// interpreter do not run out of stack.
+  std::size_t max_depth = 128;
+};
+
+namespace details {
+/// @brief splitmix64; tiny, fast and fully specified.
+class Random {
+public:
+  explicit constexpr Random(const std::uint64_t seed) noexcept : state(seed) {}
+
+  constexpr auto next() noexcept -> std::uint64_t {
+    auto z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  /// @brief uniform in `[0, bound)`; the modulo bias is irrelevant here.
+  constexpr auto below(const std::size_t bound) noexcept -> std::size_t {
+    return bound ? static_cast<std::size_t>(next() % bound) : 0;
+  }
+  /// @brief uniform in `[low, high]`.
+  constexpr auto between(const std::size_t low,
+                         const std::size_t high) noexcept -> std::size_t {
+    return low + below(high - low + 1);
+  }
+
+private:
+  std::uint64_t state;
+};
+
+class Generator {
+public:
+  explicit Generator(const Options &options)
+      : options(options), random(options.seed) {}
+
+  auto generate() -> std::string {
+    script += "// generated: shape=";
+    script += shape_name(options.shape);
+    script += " size=" + std::to_string(options.size) +
+              " seed=" + std::to_string(options.seed) + "\n";
+    script += "var acc = 0;\n";
+    if (options.shape == Shape::kNestedScopes) {
+      // here one unit is one level, so that the size still scales the script.
+      for (auto levels = options.size; levels;) {
+        const auto depth = std::min(levels, max_depth());
+        nest(depth);
+        levels -= depth;
+      }
+    } else
+      for (auto unit = std::size_t{}; unit < options.size; ++unit)
+        emit(options.shape == Shape::kMixed
+                 ? kShapes[random.below(kShapes.size() - 1)]
+                 : options.shape);
+    script += "print acc;\n";
+    return std::move(script);
+  }
+
+private:
+  auto max_depth() const noexcept -> std::size_t {
+    return std::max<std::size_t>(options.max_depth, 2);
+  }
+  void emit(const Shape shape) {
+    switch (shape) {
+    case Shape::kNestedScopes:
+      return nest(random.between(2, std::min<std::size_t>(16, max_depth())));
+    case Shape::kManyFunctions:
+      return function();
+    case Shape::kExpressionChains:
+      return chain();
+    case Shape::kStringLiterals:
+      return string();
+    case Shape::kClosures:
+      return closure();
+    case Shape::kMixed:
+      break;
+    }
+  }
+  void line(const std::size_t depth, const std::string_view text) {
+    script.append(std::min<std::size_t>(depth, 20) * 2, ' ');
+    script += text;
+    script += '\n';
+  }
+  void nest(const std::size_t depth) {
+    if (!depth)
+      return;
+    const auto prefix = "n" + std::to_string(nests++) + "_";
+    for (auto level = std::size_t{}; level < depth; ++level) {
+      line(level, "{");
+      line(level + 1,
+           "var " + prefix + std::to_string(level) + " = " +
+               (level ? prefix + std::to_string(level - 1) + " + 1"
+                      : std::to_string(random.below(100))) +
+               ";");
+    }
+    line(depth, "for (var i = 0; i < 8; i = i + 1) acc = acc + " + prefix +
+                    "0;");
+    for (auto level = depth; level-- > 0;)
+      line(level, "}");
+  }
+  void function() {
+    const auto name = "f" + std::to_string(functions++);
+    const auto constant = std::to_string(random.between(1, 99));
+    line(0, "fun " + name + "(a, b) {");
+    line(1, "if (a > b) return a - b + " + constant + ";");
+    line(1, "return b - a + " + constant + ";");
+    line(0, "}");
+    // call a random function declared so far, so lookups span the globals.
+    line(0,
+         "acc = f" + std::to_string(random.below(functions)) + "(acc, " +
+             constant + ");");
+  }
+  void chain() {
+    auto expression = std::string{};
+    auto open_groups = std::size_t{};
+    const auto terms = random.between(16, 128);
+    for (auto term = std::size_t{}; term < terms; ++term) {
+      if (term) {
+        constexpr auto operators = std::string_view{"+-*/"};
+        const auto op = operators[random.below(operators.size())];
+        expression += ' ';
+        expression += op;
+        expression += ' ';
+        // never divide by a variable, which may be zero.
+        if (op == '/') {
+          expression += std::to_string(random.between(1, 9));
+          continue;
+        }
+      }
+      if (open_groups < 4 && random.below(8) == 0) {
+        expression += '(';
+        ++open_groups;
+      }
+      expression += chains && random.below(4) == 0
+                        ? "e" + std::to_string(random.below(chains))
+                        : std::to_string(random.between(1, 99));
+      if (open_groups && random.below(4) == 0) {
+        expression += ')';
+        --open_groups;
+      }
+    }
+    expression.append(open_groups, ')');
+    line(0, "var e" + std::to_string(chains++) + " = " + expression + ";");
+  }
+  void string() {
+    constexpr auto alphabet =
+        std::string_view{"abcdefghijklmnopqrstuvwxyz0123456789 "};
+    auto literal = std::string(random.between(16, 4096), ' ');
+    for (auto &ch : literal)
+      ch = alphabet[random.below(alphabet.size())];
+    const auto name = "s" + std::to_string(strings++);
+    line(0, "var " + name + " = \"" + literal + "\";");
+    line(0,
+         "var t" + name + " = " + name + " + s" +
+             std::to_string(random.below(strings)) + ";");
+  }
+  void closure() {
+    const auto id = std::to_string(closures++);
+    line(0, "fun make" + id + "(step) {");
+    line(1, "var count = 0;");
+    line(1, "fun next() {");
+    line(2, "count = count + step;");
+    line(2, "return count;");
+    line(1, "}");
+    line(1, "return next;");
+    line(0, "}");
+    line(0,
+         "var c" + id + " = make" + id + "(" +
+             std::to_string(random.between(1, 9)) + ");");
+    for (auto call = random.between(1, 4); call-- > 0;)
+      line(0, "c" + id + "();");
+    line(0, "acc = acc + c" + id + "();");
+  }
+
+private:
+  const Options &options;
+  Random random;
+  std::string script;
+  std::size_t nests = 0;
+  std::size_t functions = 0;
+  std::size_t chains = 0;
+  std::size_t strings = 0;
+  std::size_t closures = 0;
+};
+} // namespace details
+
+/// @brief the whole script; it prints a single number, `acc`, at the end.
+inline auto generate(const Options &options) -> std::string {
+  return details::Generator{options}.generate();
+}
+} // namespace workload
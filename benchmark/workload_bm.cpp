@@ -0,0 +1,125 @@
+/// @file workload_bm.cpp
+/// @brief lexer, parser and interpreter throughput on generated scripts of
+/// growing size; see workload.hpp for the shapes.
+/// @note every benchmark reports `bytes_per_second` and fits a complexity
+/// over the script size, so superlinear phases stand out right away. Use
+/// `--benchmark_format=csv` to plot the throughput against the size.
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include "test_env.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "interpreter.hpp"
+#include "workload.hpp"
+namespace {
+namespace utils = net::ancillarycat::utils;
+using workload::Shape;
+
+auto source_for(const benchmark::State &state, const Shape shape)
+    -> std::string {
+  return workload::generate(
+      {.shape = shape, .size = static_cast<std::size_t>(state.range(0))});
+}
+auto lex(lexer &scanner, const std::string &source) -> utils::Status {
+  if (auto res = scanner.load(std::istringstream{source}); !res)
+    return res;
+  if (auto res = scanner.lex(); !res)
+    return res;
+  if (!scanner.ok())
+    return {utils::Status::kLexError, "generated script has lex errors"};
+  return utils::OkStatus();
+}
+void report(benchmark::State &state, const std::string &source) {
+  const auto bytes = static_cast<std::int64_t>(source.size());
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          bytes);
+  state.SetComplexityN(bytes);
+  state.counters["script_KiB"] = static_cast<double>(bytes) / 1024;
+}
+void skip(benchmark::State &state, const utils::Status &status) {
+  state.SkipWithError(std::string{status.message()}.c_str());
+}
+
+void BM_Lex(benchmark::State &state, const Shape shape) {
+  const auto source = source_for(state, shape);
+  for (auto _ : state) {
+    auto scanner = lexer{};
+    if (auto res = lex(scanner, source); !res)
+      return skip(state, res);
+    benchmark::DoNotOptimize(scanner.get_tokens().data());
+  }
+  report(state, source);
+}
+void BM_Parse(benchmark::State &state, const Shape shape) {
+  const auto source = source_for(state, shape);
+  auto scanner = lexer{};
+  if (auto res = lex(scanner, source); !res)
+    return skip(state, res);
+  for (auto _ : state) {
+    auto ast = parser{};
+    ast.set_views(scanner.get_tokens());
+    if (auto res = ast.parse(parser::kStatement); !res)
+      return skip(state, res);
+    benchmark::DoNotOptimize(ast.get_statements().data());
+  }
+  report(state, source);
+}
+/// @brief BM_Parse with the function bodies left for their first call.
+void BM_ParseLazy(benchmark::State &state, const Shape shape) {
+  const auto source = source_for(state, shape);
+  auto scanner = lexer{};
+  if (auto res = lex(scanner, source); !res)
+    return skip(state, res);
+  for (auto _ : state) {
+    auto ast = parser{};
+    ast.set_views(scanner.get_tokens())
+        .set_function_bodies(parser::FunctionBodies::kLazy);
+    if (auto res = ast.parse(parser::kStatement); !res)
+      return skip(state, res);
+    benchmark::DoNotOptimize(ast.get_statements().data());
+  }
+  report(state, source);
+}
+void BM_Interpret(benchmark::State &state, const Shape shape) {
+  const auto source = source_for(state, shape);
+  auto scanner = lexer{};
+  if (auto res = lex(scanner, source); !res)
+    return skip(state, res);
+  auto ast = parser{};
+  ast.set_views(scanner.get_tokens());
+  if (auto res = ast.parse(parser::kStatement); !res)
+    return skip(state, res);
+  // the AST is only read by the interpreter, so every iteration reuses it.
+  for (auto _ : state) {
+    auto runner = interpreter{};
+    if (auto res = runner.interpret(ast.get_statements()); !res)
+      return skip(state, res);
+  }
+  report(state, source);
+}
+
+[[maybe_unused]] const auto registered = [] {
+  using benchmark_t = void (*)(benchmark::State &, Shape);
+  constexpr std::pair<const char *, benchmark_t> phases[] = {
+      {"BM_Lex", BM_Lex},
+      {"BM_Parse", BM_Parse},
+      {"BM_ParseLazy", BM_ParseLazy},
+      {"BM_Interpret", BM_Interpret}};
+  for (const auto &[phase, function] : phases)
+    for (const auto shape : workload::kShapes)
+      benchmark::RegisterBenchmark(
+          (std::string{phase} + '/' + std::string{shape_name(shape)}).c_str(),
+          function,
+          shape)
+          ->RangeMultiplier(4)
+          ->Range(16, 4096)
+          ->Complexity();
+  return true;
+}();
+} // namespace
+
+BENCHMARK_MAIN();
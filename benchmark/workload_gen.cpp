@@ -0,0 +1,55 @@
+/// @file workload_gen.cpp
+/// @brief write a generated Lox script to stdout, e.g. to keep a corpus next
+/// to a profile or to run it through `interpreter run`.
+/// @note usage:
+///   workload_gen [--shape=<name>] [--size=<units>] [--seed=<n>]
+///                [--max-depth=<levels>]
+/// shapes: nested_scopes, many_functions, expression_chains, string_literals,
+/// closures and mixed (default). The same arguments always give the same
+/// script.
+#include <charconv>
+#include <cstdio>
+#include <print>
+#include <string_view>
+
+#include "workload.hpp"
+
+namespace {
+template <typename Integer>
+auto parse_option(const std::string_view arg,
+                  const std::string_view name,
+                  Integer &value) -> bool {
+  if (!arg.starts_with(name))
+    return false;
+  const auto text = arg.substr(name.size());
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && ptr == text.data() + text.size();
+}
+} // namespace
+
+int main(const int argc, char **argv) {
+  auto options = workload::Options{};
+  for (auto i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (arg.starts_with("--shape=")) {
+      const auto shape = workload::parse_shape(arg.substr(8));
+      if (!shape) {
+        std::println(stderr, "unknown shape: {}", arg.substr(8));
+        return 2;
+      }
+      options.shape = *shape;
+    } else if (!parse_option(arg, "--size=", options.size) &&
+               !parse_option(arg, "--seed=", options.seed) &&
+               !parse_option(arg, "--max-depth=", options.max_depth)) {
+      std::println(stderr,
+                   "usage: {} [--shape=<name>] [--size=<units>] "
+                   "[--seed=<n>] [--max-depth=<levels>]",
+                   argv[0]);
+      return 2;
+    }
+  }
+  const auto script = workload::generate(options);
+  std::fwrite(script.data(), 1, script.size(), stdout);
+  return 0;
+}
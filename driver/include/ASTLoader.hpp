@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief reads programs written by @link ASTWriter @endlink back into trees
+/// that run as if they had just been parsed.
+/// @note the format is told by the first bytes: the binary magic, or JSON
+/// otherwise. The input is validated on the way, since it may come from other
+/// tools: a malformed or truncated program, an unknown version, a missing
+/// child or a token of the wrong type fails the load instead of the run.
+class LOXO_API ASTLoader {
+public:
+  using string_view_type = std::string_view;
+  using stmt_ptr_t = std::shared_ptr<statement::Stmt>;
+  using stmt_ptrs_t = std::vector<stmt_ptr_t>;
+
+  /// @brief deeper nesting fails to load rather than overflowing the stack.
+  static constexpr std::size_t kMaxDepth = 2048;
+
+public:
+  ASTLoader() = default;
+
+public:
+  /// @brief replace the statements with the program serialized in @p data.
+  auto load(string_view_type data) -> utils::Status;
+  auto get_statements() noexcept -> stmt_ptrs_t & { return my_statements; }
+
+private:
+  stmt_ptrs_t my_statements;
+};
+} // namespace net::ancillarycat::loxo
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief serializes whole programs, statements and expressions alike, into
+/// one contiguous buffer; @link ASTLoader @endlink reads them back.
+/// @note the tree is walked by switching over the node kinds, so neither
+/// visitors nor virtual calls are involved, and the buffer only ever grows.
+///
+/// Schema version 1, binary (`parse --format=bin`):
+///
+///     program    := "LXA" version:u8 count:varint statement{count}
+///     statement  := tag:u8 line:varint field*
+///     expression := tag:u8 field* | 0 (none)
+///     token      := type:u8 lexeme:string line:varint
+///     string     := size:varint byte{size}
+///     list       := count:varint item{count}
+///
+/// varints are unsigned LEB128, the tags are those of @link Tag @endlink and
+/// the token types the values of @link TokenType::type_t @endlink. The
+/// fields come in the order of the JSON fields below.
+///
+/// JSON (`parse --format=json`):
+///
+///     {"format":"loxo-ast","version":1,"statements":[statement...]}
+///
+/// with every node an object `{"node":<name>, ...fields}`, statements with
+/// a `"line"`, and tokens `{"type":"PLUS","lexeme":"+","line":1}`; a
+/// missing child is `null`:
+///
+///     Literal    token                 Var         name, initializer
+///     Unary      operator, operand     Print       value
+///     Binary     operator, left, right Expression  expression
+///     Variable   name                  Block       statements[]
+///     Grouping   expression            If          condition, then, else
+///     Assignment name, value           While       condition, body
+///     Logical    operator, left, right For         initializer, condition,
+///     Call       callee, paren,                    increment, body
+///                arguments[]           Function    name, parameters[],
+///                                                  body[]
+///                                      Return      value
+class LOXO_API ASTWriter {
+public:
+  using string_type = std::string;
+  using string_view_type = std::string_view;
+  using stmt_ptr_t = std::shared_ptr<statement::Stmt>;
+
+  enum class Format : std::uint8_t { kBinary, kJson };
+  /// @brief the node tags of the binary form; never renumbered, new nodes
+  /// get new numbers.
+  enum class Tag : std::uint8_t {
+    kNone = 0,
+    // expressions.
+    kLiteral = 1,
+    kUnary = 2,
+    kBinary = 3,
+    kVariable = 4,
+    kGrouping = 5,
+    kAssignment = 6,
+    kLogical = 7,
+    kCall = 8,
+    // statements.
+    kVar = 16,
+    kPrint = 17,
+    kExpression = 18,
+    kBlock = 19,
+    kIf = 20,
+    kWhile = 21,
+    kFor = 22,
+    kFunction = 23,
+    kReturn = 24,
+  };
+  static constexpr string_view_type kMagic = "LXA";
+  static constexpr std::uint8_t kVersion = 1;
+  static constexpr string_view_type kJsonFormat = "loxo-ast";
+
+public:
+  explicit ASTWriter(Format);
+
+public:
+  /// @brief serialize the program made of @p statements, after whatever was
+  /// written before. Function bodies left for their first call are parsed
+  /// first; if one does not parse, its syntax error is returned and nothing
+  /// of this program is kept.
+  auto write(std::span<const stmt_ptr_t> statements) -> utils::Status;
+  auto view() const noexcept -> string_view_type { return my_buffer; }
+  /// @brief the serialized programs; the writer is empty afterwards.
+  auto take() noexcept -> string_type;
+
+  /// @brief the JSON name of @p tag, empty for @link Tag::kNone @endlink
+  static auto name_of(Tag) noexcept -> string_view_type;
+
+private:
+  Format my_format;
+  string_type my_buffer;
+};
+} // namespace net::ancillarycat::loxo
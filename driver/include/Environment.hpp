@@ -1,6 +1,7 @@
 #ifndef AC_LOXO_ENVIRONMENT_HPP
 #define AC_LOXO_ENVIRONMENT_HPP
 
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <optional>
@@ -8,15 +9,43 @@
 #include <string_view>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
+#include <net/ancillarycat/utils/SmallVector.hpp>
 #include <net/ancillarycat/utils/Status.hpp>
 
 #include "details/loxo_fwd.hpp"
 
 #include "details/IVisitor.hpp"
+#include "details/LookupCache.hpp"
 #include "details/ScopeAssoc.inl"
 
 namespace net::ancillarycat::loxo {
+/// @brief a variable captured by a closure.
+/// @note while the environment that declared the variable is alive the upvalue
+/// is @a open and points into that environment; when the environment goes away
+/// the value is moved into the upvalue itself, i.e. it is @a closed.
+class Upvalue {
+public:
+  using variant_type = utils::IVisitor::variant_type;
+
+public:
+  explicit Upvalue(variant_type *location) noexcept : my_location(location) {}
+  Upvalue(const Upvalue &) = delete;
+  auto operator=(const Upvalue &) = delete;
+
+public:
+  auto get() const noexcept -> variant_type & { return *my_location; }
+  auto location() const noexcept -> const variant_type * {
+    return my_location;
+  }
+  auto is_open() const noexcept -> bool { return my_location != &my_closed; }
+  void close();
+
+private:
+  variant_type *my_location;
+  variant_type my_closed;
+};
 
 class Environment : public utils::Printable,
                     public std::enable_shared_from_this<Environment> {
@@ -24,25 +53,49 @@ public:
   using string_view_type = evaluation::ScopeAssoc::string_view_type;
   using scope_env_t = evaluation::ScopeAssoc;
   using self_type = Environment;
+  using variant_type = utils::IVisitor::variant_type;
+  /// @brief positional storage of a function frame; arguments are evaluated
+  /// straight into it.
+  using frame_slots_t = utils::IVisitor::args_t;
+  using slot_names_t = std::shared_ptr<const std::vector<string_type>>;
+  using upvalue_ptr_t = std::shared_ptr<Upvalue>;
+  using upvalues_t = std::vector<upvalue_ptr_t>;
 
 public:
-  Environment() = default;
+  Environment();
   explicit Environment(const std::shared_ptr<self_type> &);
   Environment(const Environment &) = delete;
   auto operator=(const Environment &) = delete;
   Environment(Environment &&) noexcept;
   auto operator=(Environment &&) noexcept -> Environment &;
-  virtual ~Environment() override = default;
+  /// @brief closes the upvalues that still point into this environment.
+  virtual ~Environment() override;
 
 public:
-  static auto getGlobalEnvironment()
-      -> utils::StatusOr<std::shared_ptr<self_type>>;
+  /// @brief create a global environment holding the native functions; every
+  /// interpreter owns its own, so that interpreters of the same process do
+  /// not see each other's globals.
+  static auto createGlobalEnvironment() -> std::shared_ptr<self_type>;
   static auto createScopeEnvironment(const std::shared_ptr<self_type> &)
       -> std::shared_ptr<self_type>;
+  /// @brief create the environment of a function call. The slots share the
+  /// allocation of the environment itself, so binding up to
+  /// @link utils::IVisitor::kInlineArgs @endlink arguments allocates nothing.
+  static auto createFrameEnvironment(const std::shared_ptr<self_type> &,
+                                     const slot_names_t &)
+      -> std::shared_ptr<self_type>;
+  /// @brief create the environment a closure is defined in: captures
+  /// @p names from @p enclosing as upvalues and chains up to the global
+  /// environment, so that nothing else of @p enclosing is kept alive.
+  /// @note names that resolve to globals (or nothing yet) are not captured and
+  /// are looked up in the global environment at call time. If nothing is
+  /// captured at all, the global environment itself is returned.
+  static auto createClosureEnvironment(const std::shared_ptr<self_type> &,
+                                       const slot_names_t &)
+      -> std::shared_ptr<self_type>;
 
 public:
-  auto find(const string_type &) const
-      -> std::optional<self_type::scope_env_t::associations_t::iterator>;
+  auto find(const string_type &) const -> variant_type *;
   auto
   add(const string_type &,
       const utils::IVisitor::variant_type &,
@@ -52,12 +105,57 @@ public:
                 const utils::IVisitor::variant_type &,
                 uint_least32_t) const -> utils::Status;
   auto get(const string_type &) const -> utils::IVisitor::variant_type;
+  /// @brief like @link find @endlink, but consults and refills the inline
+  /// cache of the node doing the lookup.
+  auto find(LookupCache &) const -> variant_type *;
   auto copy() const -> std::shared_ptr<self_type>;
+  /// @brief drop every binding of this environment, which breaks the cycles
+  /// through the functions declared in it.
+  void clear() const;
+  /// @brief the slots of a function frame, in parameter order.
+  /// @pre the environment was created by @link createFrameEnvironment
+  /// @endlink
+  auto slots() const -> frame_slots_t &;
+
+private:
+  struct Frame;
+
+private:
+  /// @brief close @link my_open_upvalues @endlink, moving the values out of
+  /// this environment.
+  void close_upvalues();
+  auto find_slot(const string_type &) const -> variant_type *;
+  auto find_upvalue(const string_type &) const -> Upvalue *;
+  /// @brief find the variable in this very environment, not the enclosing ones.
+  auto find_local(const string_type &) const -> variant_type *;
+  /// @brief @link find_local @endlink plus the captured upvalues.
+  auto find_here(const string_type &) const -> variant_type *;
+  /// @brief @link find_here @endlink recording where the binding lives into
+  /// @p cache
+  auto find_here(LookupCache &) const -> variant_type *;
+  auto binding_count() const noexcept -> std::uint32_t;
+  /// @brief the upvalue of @p name as seen from this environment, or nullptr
+  /// if it is a global one.
+  auto capture(const string_type &) const -> upvalue_ptr_t;
+  auto root() const -> std::shared_ptr<self_type>;
+  static auto next_serial() noexcept -> std::uint64_t;
 
 private:
   mutable scope_env_t current;
   std::shared_ptr<self_type> parent;
-  static inline std::shared_ptr<self_type> global_env;
+  /// @brief non-null only for function frames; owned by the enclosing
+  /// @link Frame @endlink
+  frame_slots_t *my_slots = nullptr;
+  slot_names_t my_slot_names;
+  /// @brief captured variables, non-empty only for closure environments;
+  /// parallel to @link my_upvalue_names @endlink, null for globals.
+  upvalues_t my_upvalues;
+  slot_names_t my_upvalue_names;
+  /// @brief upvalues of closures pointing into this environment.
+  mutable upvalues_t my_open_upvalues;
+  /// @brief unique for the lifetime of the program; identifies the
+  /// environment in a @link LookupCache @endlink.
+  std::uint64_t my_serial = next_serial();
 
 private:
   auto to_string_impl(const utils::FormatPolicy &) const
@@ -111,6 +111,18 @@ public:
       string_type &&,
       uint_least32_t line =
           std::numeric_limits<uint_least32_t>::quiet_NaN()) noexcept;
+  /// @brief share an existing buffer.
+  explicit String(
+      std::shared_ptr<const string_type>,
+      uint_least32_t line =
+          std::numeric_limits<uint_least32_t>::quiet_NaN()) noexcept;
+  /// @brief the canonical string with these contents, shared with every other
+  /// interned string that has them; used for string literals.
+  /// @note thread-safe; the canonical string goes once nothing refers to it.
+  static auto intern(
+      string_view_type,
+      uint_least32_t line = std::numeric_limits<uint_least32_t>::quiet_NaN())
+      -> String;
   String(const String &);
   String(String &&) noexcept;
   String &operator=(const String &);
@@ -128,9 +140,30 @@ private:
       -> string_type override;
   auto to_string_view_impl(const utils::FormatPolicy &) const
       -> string_view_type override;
+  auto str() const -> const string_type &;
+
+public:
+  auto size() const noexcept -> std::size_t;
+  /// @brief computed once and cached on the shared buffer.
+  auto hash() const -> std::size_t;
 
 private:
-  string_type value;
+  /// @brief a node of the concatenation tree.
+  struct Rope;
+  /// @brief results up to this size are copied right away instead of
+  /// becoming a @link Rope @endlink node.
+  static constexpr std::size_t kFlatConcatLimit = 64;
+
+private:
+  String(std::shared_ptr<const Rope>, uint_least32_t) noexcept;
+  /// @brief a single flat node holding a copy of @p value.
+  template <typename Value>
+  static auto make_flat(Value &&value) -> std::shared_ptr<const Rope>;
+
+private:
+  /// @brief immutable (up to lazy flattening) and shared between copies, so
+  /// that copying a string value never copies its characters and `+` is O(1).
+  std::shared_ptr<const Rope> value;
 };
 
 class Number : public Value {
@@ -161,22 +194,61 @@ public:
   Number &operator*=(const Number &);
   Number &operator/=(const Number &);
 
+public:
+  auto is_integer() const noexcept -> bool { return my_is_integer; }
+  auto as_real() const noexcept -> long double {
+    return my_is_integer ? static_cast<long double>(integer) : value;
+  }
+
+private:
+  /// @brief integral values up to this magnitude are kept in @link integer
+  /// @endlink; every one of them is exactly representable as a `long double`
+  /// (even where that is just a `double`), so the observable semantics are
+  /// those of floating point.
+  static constexpr std::int64_t kMaxInteger = std::int64_t{1} << 53;
+  static auto from_integer(std::int64_t) noexcept -> Number;
+  static auto from_real(long double) noexcept -> Number;
+
 private:
-  long double value = std::numeric_limits<long double>::quiet_NaN();
+  union {
+    long double value = std::numeric_limits<long double>::quiet_NaN();
+    std::int64_t integer;
+  };
+  bool my_is_integer = false;
 
 private:
   auto to_string_impl(const utils::FormatPolicy &) const
       -> string_type override;
 };
+/// @brief the immutable part of a function: everything but the environment it
+/// closes over. One prototype is shared by every closure created from the
+/// same declaration, so copying a function value never copies its body.
+struct FunctionPrototype {
+  using string_type = utils::Viewable::string_type;
+  using stmt_ptr_t = std::shared_ptr<statement::Stmt>;
+  using args_t = utils::IVisitor::args_t;
+  using native_function_t = std::function<utils::IVisitor::variant_type(
+      const interpreter &, args_t &)>;
+  using slot_names_t = std::shared_ptr<const std::vector<string_type>>;
+
+  string_type name;
+  unsigned arity = 0;
+  /// @brief the line the function was declared on; 0 for native functions.
+  uint_least32_t line = 0;
+  /// @brief shared with every frame of this function so that the frame can
+  /// look its slots up by name without copying the names.
+  slot_names_t parameters;
+  std::vector<stmt_ptr_t> body;
+  /// @brief set instead of @link body @endlink when the parser left the body
+  /// for the first call, which parses it.
+  std::shared_ptr<statement::LazyBody> lazy_body;
+  /// @brief the upvalue layout: free variables of the body, captured from the
+  /// declaring scope when a closure is created.
+  slot_names_t upvalue_names;
+  /// @brief empty for functions declared in lox.
+  native_function_t native;
+};
 class Callable : public Evaluatable {
-  struct Function {
-    using token_t = Token;
-    using stmt_ptr_t = std::shared_ptr<statement::Stmt>;
-    string_type name;
-    std::vector<string_type> parameters;
-    std::vector<stmt_ptr_t> body;
-  };
-
 public:
   // enum type_t : uint8_t {
   //   kOrdinary = 0,
@@ -184,41 +256,75 @@ public:
   // };
 
 public:
-  using args_t = std::vector<utils::IVisitor::variant_type>;
+  using args_t = FunctionPrototype::args_t;
   using string_view_type = utils::Viewable::string_view_type;
-  using native_function_t = std::function<utils::IVisitor::variant_type(
-      const interpreter &, args_t &)>;
-  using custom_function_t = Function;
-  using function_t =
-      utils::Variant<utils::Monostate, native_function_t, custom_function_t>;
+  using native_function_t = FunctionPrototype::native_function_t;
+  using prototype_t = FunctionPrototype;
+  using prototype_ptr_t = std::shared_ptr<const prototype_t>;
   using env_t = Environment;
   using env_ptr_t = std::shared_ptr<env_t>;
 
 public:
   Callable() = default;
+  /// @brief a copy always holds the environment, see @link
+  /// hold_environment_weakly @endlink.
+  Callable(const Callable &);
+  Callable(Callable &&) noexcept = default;
+  auto operator=(const Callable &) -> Callable &;
+  auto operator=(Callable &&) noexcept -> Callable & = default;
   virtual ~Callable() = default;
 
 private:
-  Callable(unsigned, native_function_t &&, const env_ptr_t &);
-  Callable(unsigned, custom_function_t &&, const env_ptr_t &);
+  Callable(prototype_ptr_t &&, const env_ptr_t &);
 
 public:
-  static auto create_custom(unsigned, custom_function_t &&, const env_ptr_t &)
+  /// @brief a closure over @p env, which is usually made by
+  /// @link Environment::createClosureEnvironment @endlink; the prototype is
+  /// cached on the declaration so that executing it again is two pointer
+  /// copies.
+  static auto create_custom(const prototype_ptr_t &, const env_ptr_t &)
       -> Callable;
   static auto create_native(unsigned, native_function_t &&, const env_ptr_t &)
       -> Callable;
 
 public:
-  constexpr inline auto arity() const -> unsigned { return my_arity; }
+  auto arity() const noexcept -> unsigned {
+    return my_prototype ? my_prototype->arity : 0;
+  }
+  auto is_native() const noexcept -> bool;
+  auto prototype() const noexcept -> const prototype_ptr_t & {
+    return my_prototype;
+  }
+  /// @brief the environment the function closes over; null once a weakly
+  /// held one is gone.
+  auto environment() const -> env_ptr_t {
+    return my_env ? my_env : my_weak_env.lock();
+  }
+  /// @brief stop owning the environment. Used when the callable sits in an
+  /// upvalue of its own closure environment, i.e. a local function that
+  /// calls itself, where owning it would keep both alive forever; whoever
+  /// reaches the upvalue keeps that environment alive anyway.
+  void hold_environment_weakly() noexcept {
+    if (my_env)
+      my_weak_env = std::exchange(my_env, nullptr);
+  }
 
 public:
+  /// @brief create the frame of a call to this (non-native) function; the
+  /// caller evaluates the arguments directly into its
+  /// @link Environment::slots @endlink.
+  auto make_frame() const -> env_ptr_t;
   auto call(const interpreter &, args_t &&) const -> eval_result_t;
+  /// @brief call with a frame from @link make_frame @endlink whose slots are
+  /// already bound.
+  auto call(const interpreter &, env_ptr_t &&) const -> eval_result_t;
 
 private:
-  // dont support static variables in this function
-  unsigned my_arity = std::numeric_limits<unsigned>::quiet_NaN();
-  function_t my_function{utils::Monostate{}};
+  prototype_ptr_t my_prototype;
   env_ptr_t my_env;
+  /// @brief set instead of @link my_env @endlink by @link
+  /// hold_environment_weakly @endlink.
+  std::weak_ptr<env_t> my_weak_env;
 
 private:
   static constexpr auto native_signature = "<native fn>"sv;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <net/ancillarycat/utils/format.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief deterministic execution counters, enabled by `--counts`.
+/// @note unlike the @link Profiler @endlink, every function call and every
+/// executed statement is recorded: how often it ran and how long it took,
+/// both inclusive (with everything it ran) and exclusive (without the nested
+/// calls, or without the nested statements for a line). A recursive function
+/// or line only adds its inclusive time at its outermost activation, so the
+/// inclusive time is never counted twice.
+class LOXO_API Instrumentation : public utils::Printable {
+public:
+  using clock_t = std::chrono::steady_clock;
+  using duration_t = clock_t::duration;
+  using line_t = uint_least32_t;
+  using prototype_t = evaluation::FunctionPrototype;
+
+  struct Counters {
+    std::uint64_t executions = 0;
+    duration_t inclusive{};
+    duration_t exclusive{};
+    /// @brief how many activations are currently open; see the class note.
+    std::size_t active = 0;
+  };
+  /// @brief records a function call for its lifetime, if @p instrumentation
+  /// is not null.
+  class FunctionScope {
+  public:
+    FunctionScope(Instrumentation *instrumentation,
+                  const prototype_t &prototype)
+        : my_instrumentation(instrumentation) {
+      if (my_instrumentation) [[unlikely]]
+        my_instrumentation->enter_function(prototype);
+    }
+    FunctionScope(const FunctionScope &) = delete;
+    auto operator=(const FunctionScope &) = delete;
+    ~FunctionScope() {
+      if (my_instrumentation) [[unlikely]]
+        my_instrumentation->leave_function();
+    }
+
+  private:
+    Instrumentation *my_instrumentation;
+  };
+  /// @brief records a statement for its lifetime, if @p instrumentation is
+  /// not null.
+  class LineScope {
+  public:
+    LineScope(Instrumentation *instrumentation, const line_t line)
+        : my_instrumentation(instrumentation) {
+      if (my_instrumentation) [[unlikely]]
+        my_instrumentation->enter_line(line);
+    }
+    LineScope(const LineScope &) = delete;
+    auto operator=(const LineScope &) = delete;
+    ~LineScope() {
+      if (my_instrumentation) [[unlikely]]
+        my_instrumentation->leave_line();
+    }
+
+  private:
+    Instrumentation *my_instrumentation;
+  };
+
+public:
+  Instrumentation() = default;
+  virtual ~Instrumentation() override = default;
+
+public:
+  struct Activation {
+    Counters *counters;
+    clock_t::time_point start;
+    duration_t children{};
+  };
+  template <typename Key> struct Table {
+    std::unordered_map<Key, Counters> counters;
+    std::vector<Activation> stack;
+  };
+
+private:
+  void enter_function(const prototype_t &);
+  void leave_function();
+  void enter_line(line_t);
+  void leave_line();
+
+private:
+  Table<const prototype_t *> my_functions;
+  Table<line_t> my_lines;
+
+private:
+  /// @brief two tables sorted by exclusive time, hottest first.
+  auto to_string_impl(const utils::FormatPolicy &) const
+      -> string_type override;
+};
+} // namespace net::ancillarycat::loxo
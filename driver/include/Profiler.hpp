@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief a sampling profiler for lox code, enabled by `--profile=<file>`.
+/// @note the profiled thread keeps a shadow stack of the lox functions it is
+/// in (see @link Scope @endlink); a timer thread copies that stack every
+/// @link interval @endlink and counts identical stacks. The result is written
+/// in the folded format understood by `flamegraph.pl` and speedscope, one
+/// `<script>;outer:line;inner:line count` per line, where `line` is the line
+/// the function was declared on.
+class LOXO_API Profiler {
+public:
+  using string_type = std::string;
+  using path_type = std::filesystem::path;
+  using interval_type = std::chrono::microseconds;
+  using prototype_t = evaluation::FunctionPrototype;
+
+  static constexpr auto kDefaultInterval = interval_type{1000};
+  /// @brief frames deeper than this still count, but are not recorded.
+  static constexpr std::size_t kMaxDepth = 256;
+
+  /// @brief pushes a frame on construction and pops it on destruction, if a
+  /// profiler is running; otherwise it costs a single branch.
+  class Scope {
+  public:
+    explicit Scope(const prototype_t &prototype) noexcept {
+      if (const auto profiler = active.load(std::memory_order_relaxed))
+          [[unlikely]]
+        my_profiler = profiler->enter(prototype);
+    }
+    Scope(const Scope &) = delete;
+    auto operator=(const Scope &) = delete;
+    ~Scope() noexcept {
+      if (my_profiler) [[unlikely]]
+        my_profiler->leave();
+    }
+
+  private:
+    Profiler *my_profiler = nullptr;
+  };
+
+public:
+  explicit Profiler(interval_type = kDefaultInterval);
+  Profiler(const Profiler &) = delete;
+  auto operator=(const Profiler &) = delete;
+  ~Profiler();
+
+public:
+  /// @brief start sampling the calling thread.
+  auto start() -> utils::Status;
+  /// @brief stop sampling; the samples are kept.
+  void stop();
+  auto samples() const noexcept -> std::size_t { return my_sample_count; }
+  /// @brief the collected stacks in the folded format.
+  auto folded() const -> string_type;
+  auto write(const path_type &) const -> utils::Status;
+
+private:
+  /// @return `this` if the frame was pushed, `nullptr` if the caller is not
+  /// the profiled thread.
+  auto enter(const prototype_t &) noexcept -> Profiler *;
+  void leave() noexcept;
+  void sample();
+  void run();
+
+private:
+  /// @brief the running profiler, if any; only one may run at a time.
+  static inline constinit std::atomic<Profiler *> active = nullptr;
+
+private:
+  interval_type my_interval;
+  std::thread::id my_owner;
+  std::thread my_sampler;
+  std::atomic<bool> my_stop = false;
+  /// @brief bumped by every push and pop so that the sampler can tell a torn
+  /// read apart, like a seqlock with a single writer.
+  std::atomic<std::uint64_t> my_generation = 0;
+  std::atomic<std::size_t> my_depth = 0;
+  std::array<std::atomic<const prototype_t *>, kMaxDepth> my_frames{};
+  /// @brief only touched by the sampler thread while it runs.
+  std::map<string_type, std::size_t> my_stacks;
+  std::size_t my_sample_count = 0;
+};
+} // namespace net::ancillarycat::loxo
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "details/loxo_fwd.hpp"
 
 #include "details/IVisitor.hpp"
@@ -7,16 +11,35 @@
 #include "StmtVisitor.hpp"
 
 namespace net::ancillarycat::loxo {
-// TODO: Implement the Resolver class
+/// @brief static free-variable analysis of a function declaration.
+/// @note a name is free if, at the point it is used, it was not declared by
+/// the function itself or any of the blocks it is nested in; that mirrors how
+/// the interpreter looks names up, since a variable declared later in the same
+/// scope is not visible yet either. The free variables of nested functions are
+/// propagated outwards, so the enclosing closure captures them too.
 class Resolver : virtual public expression::ExprVisitor,
                  virtual public statement::StmtVisitor,
                  public std::enable_shared_from_this<Resolver> {
 public:
-  inline explicit Resolver(interpreter &interpreter);
+  using names_t = std::vector<string_type>;
+
+public:
+  Resolver() = default;
   virtual ~Resolver() override = default;
 
+public:
+  /// @brief the free variables of @p function, in order of first use.
+  auto free_variables(const statement::Function &) const -> names_t;
+
+private:
+  void declare(const string_type &) const;
+  void reference(const string_type &) const;
+  auto resolve(const std::vector<std::shared_ptr<statement::Stmt>> &) const
+      -> eval_result_t;
+
 private:
-  interpreter &interpreter;
+  mutable std::vector<std::unordered_set<string_type>> scopes;
+  mutable names_t free;
 
 private:
   auto visit_impl(const expression::Literal &) const -> eval_result_t override;
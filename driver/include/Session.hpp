@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief a long-lived interpreter fed with source text line by line; backs
+/// the `repl` and `stdin` commands.
+/// @note lines are buffered until they form complete top-level declarations,
+/// i.e. the brackets are balanced and the last token is `;` or `}`. Only that
+/// chunk is then lexed, parsed and executed, against the globals left behind
+/// by the previous chunks, so the cost of a line does not depend on what came
+/// before it, and the memory held is bounded by the pending chunk. Each line
+/// is scanned once for brackets and strings; the chunk is lexed only when
+/// that scan says it may be complete. A chunk that fails is dropped; the
+/// session goes on.
+class LOXO_API Session {
+public:
+  using string_type = std::string;
+  using string_view_type = std::string_view;
+  using line_t = uint_least32_t;
+
+  struct Options {
+    /// @brief hold a complete `if` back until the next line shows whether an
+    /// `else` follows; interactively that would look stuck, so it is off by
+    /// default and `} else {` has to stay on one line.
+    bool wait_for_else = false;
+  };
+  enum class State : uint8_t {
+    /// nothing pending.
+    kIdle,
+    /// the pending chunk is not complete yet.
+    kIncomplete,
+    /// the pending chunk is a complete `if`, which an `else` may continue.
+    kMaybeElse,
+  };
+
+public:
+  Session();
+  explicit Session(const Options &);
+  Session(const Session &) = delete;
+  auto operator=(const Session &) = delete;
+  ~Session();
+
+public:
+  /// @brief append @p line, without its line break, and execute the pending
+  /// chunk if it is complete now.
+  /// @return the lex, parse or runtime error of the executed chunk, if any.
+  auto feed(string_view_type line) -> utils::Status;
+  /// @brief execute whatever is still pending, e.g. at the end of the input;
+  /// an incomplete chunk then fails to parse.
+  auto finish() -> utils::Status;
+  /// @brief the output of the chunks executed since the last call.
+  auto take_output() const -> string_type;
+  auto state() const noexcept { return my_state; }
+  /// @brief the line the pending chunk starts at.
+  auto line() const noexcept { return my_line; }
+  auto get_interpreter() const -> const interpreter &;
+
+private:
+  /// @brief lex the pending chunk and execute it if it is complete, or if
+  /// @p force is set.
+  auto advance(bool force) -> utils::Status;
+  auto execute(lexer &) -> utils::Status;
+  void drop_pending() noexcept;
+
+private:
+  /// @brief the pending chunk as far as the line scan can tell.
+  struct Progress {
+    int depth = 0;
+    bool in_string = false;
+    /// @brief the last character outside of strings and comments.
+    char last = '\0';
+
+    void scan(string_view_type) noexcept;
+    auto may_be_complete() const noexcept -> bool {
+      return !in_string && (depth < 0 || (!depth && (last == ';' || last == '}')));
+    }
+  };
+
+private:
+  Options my_options;
+  /// @note reset to its globals after a runtime error, which may leave it
+  /// inside the scope that failed.
+  std::unique_ptr<interpreter> my_interpreter;
+  string_type my_pending;
+  line_t my_pending_lines = 0;
+  line_t my_line = 1;
+  Progress my_progress;
+  State my_state = State::kIdle;
+};
+} // namespace net::ancillarycat::loxo
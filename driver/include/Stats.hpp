@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <net/ancillarycat/utils/format.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief runtime statistics of the interpreter, reported by `--stats`.
+/// @note the @link Counters @endlink are per thread and always on, since each
+/// one is a plain increment; a @link Phase @endlink snapshots them (and the
+/// clocks) around one phase of @link loxo_main @endlink. The allocation ones
+/// are only fed in builds with `LOXO_TRACK_ALLOCATIONS`, see @link
+/// tracks_allocations @endlink.
+class LOXO_API Stats : public utils::Printable {
+public:
+  using string_view_type = std::string_view;
+  using clock_t = std::chrono::steady_clock;
+
+  /// @brief what a heap allocation was made for; see @link AllocationScope
+  /// @endlink.
+  enum class AllocationKind : std::uint8_t {
+    kOther,
+    kToken,
+    kAstNode,
+    kEnvironment,
+    kString,
+    kCallable,
+  };
+  static constexpr std::size_t kAllocationKinds = 6;
+  struct Allocations {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+  };
+  struct Counters {
+    std::uint64_t tokens = 0;
+    std::uint64_t ast_nodes = 0;
+    std::uint64_t environments = 0;
+    std::uint64_t calls = 0;
+    /// @brief variable lookups answered by the @link LookupCache @endlink of
+    /// their node, and the ones that had to search the environments.
+    std::uint64_t lookup_hits = 0;
+    std::uint64_t lookup_misses = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t allocated_bytes = 0;
+    /// @brief the allocations above, split by @link AllocationKind @endlink.
+    std::array<Allocations, kAllocationKinds> allocations_by_kind{};
+  };
+  struct Record {
+    string_view_type name;
+    double wall_ms = 0;
+    double cpu_ms = 0;
+    /// @brief peak resident set size of the process at the end of the phase.
+    std::uint64_t peak_rss_kib = 0;
+    /// @brief what happened during the phase.
+    Counters counters;
+  };
+  /// @brief attributes the allocations of the calling thread to a kind until
+  /// it is destroyed; scopes nest, the innermost one wins.
+  class AllocationScope {
+  public:
+    explicit AllocationScope(const AllocationKind kind) noexcept
+        : saved(std::exchange(allocation_kind(), kind)) {}
+    AllocationScope(const AllocationScope &) = delete;
+    auto operator=(const AllocationScope &) = delete;
+    ~AllocationScope() noexcept { allocation_kind() = saved; }
+
+  private:
+    AllocationKind saved;
+  };
+  /// @brief measures from construction to destruction and then appends a
+  /// @link Record @endlink to its @link Stats @endlink.
+  class Phase {
+  public:
+    Phase(Stats &, string_view_type);
+    Phase(const Phase &) = delete;
+    auto operator=(const Phase &) = delete;
+    ~Phase();
+
+  private:
+    Stats &stats;
+    string_view_type name;
+    clock_t::time_point wall_start;
+    std::clock_t cpu_start;
+    Counters counters_start;
+  };
+
+public:
+  Stats() = default;
+  virtual ~Stats() override = default;
+
+public:
+  [[nodiscard]] auto phase(string_view_type) -> Phase;
+  auto records() const noexcept -> const std::vector<Record> & {
+    return my_records;
+  }
+  /// @brief one JSON object; the text table is @link to_string @endlink.
+  auto to_json() const -> string_type;
+
+public:
+  /// @brief counters of the calling thread.
+  static auto counters() noexcept -> Counters &;
+  /// @brief what the calling thread is allocating for right now.
+  static auto allocation_kind() noexcept -> AllocationKind &;
+  static auto kind_name(AllocationKind) noexcept -> string_view_type;
+  /// @brief whether the global `operator new` feeds the allocation counters;
+  /// if not they stay 0 and the reports say they are unavailable.
+  static auto tracks_allocations() noexcept -> bool;
+  /// @brief peak resident set size of the process so far, 0 if unknown.
+  static auto peak_rss_kib() noexcept -> std::uint64_t;
+
+private:
+  std::vector<Record> my_records;
+
+private:
+  auto to_string_impl(const utils::FormatPolicy &) const
+      -> string_type override;
+};
+} // namespace net::ancillarycat::loxo
@@ -39,6 +39,10 @@ public:
 
 public:
   string_type number_to_string(utils::FormatPolicy policy) const;
+  /// @brief append the line `tokenize` prints for this token, without the
+  /// line break, to @p out; unlike @link to_string @endlink, this allocates
+  /// nothing but what @p out needs to grow, unless the token is an error.
+  void append_to(string_type &out) const;
   constexpr auto is_type(const token_type &type) const noexcept -> bool {
     return this->type == type;
   }
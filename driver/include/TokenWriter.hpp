@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief writes tokens in the format of `tokenize`, one per line, straight
+/// to a file descriptor.
+/// @note the lines are formatted into one buffer that is reused for the whole
+/// run and handed to the descriptor once it holds @link kChunkSize @endlink
+/// bytes; nothing is flushed per token and no string is made per token.
+/// Whatever is still buffered is written by @link flush @endlink or the
+/// destructor.
+class LOXO_API TokenWriter {
+public:
+  using string_type = std::string;
+  using string_view_type = std::string_view;
+
+  static constexpr std::size_t kChunkSize = std::size_t{64} * 1024;
+
+public:
+  /// @param fd an open descriptor, e.g. 1 for stdout; not closed.
+  explicit TokenWriter(int fd);
+  TokenWriter(const TokenWriter &) = delete;
+  auto operator=(const TokenWriter &) = delete;
+  ~TokenWriter();
+
+public:
+  /// @brief append the line of @p token.
+  auto write(const Token &token) -> TokenWriter &;
+  /// @brief append @p text as is.
+  auto write(string_view_type text) -> TokenWriter &;
+  /// @brief write out everything buffered so far.
+  /// @return the first error of any write since the last call, if any.
+  auto flush() -> utils::Status;
+
+private:
+  void flush_if_full();
+  void drain();
+
+private:
+  int my_fd;
+  string_type my_buffer;
+  int my_errno = 0;
+};
+} // namespace net::ancillarycat::loxo
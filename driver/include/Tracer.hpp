@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief records spans as Chrome trace events, enabled by `--trace=<file>`.
+/// @note the output loads in `chrome://tracing` and Perfetto. Every thread
+/// writes into its own fixed-size ring without any locking, so a long run keeps
+/// its most recent events; spans nested deeper than @link Options::max_depth
+/// @endlink or shorter than @link Options::min_duration @endlink are not
+/// recorded, which bounds the size of the file. The names of the spans are
+/// not copied and must outlive @link write @endlink.
+class LOXO_API Tracer {
+public:
+  using clock_t = std::chrono::steady_clock;
+  using path_type = std::filesystem::path;
+  using string_type = std::string;
+  using string_view_type = std::string_view;
+  using line_t = uint_least32_t;
+
+  struct Options {
+    /// @brief events kept per thread.
+    std::size_t capacity = 1 << 16;
+    std::size_t max_depth = 32;
+    std::chrono::nanoseconds min_duration = std::chrono::microseconds{1};
+  };
+  struct Event {
+    string_view_type name;
+    /// @brief source line of a statement or of the declaration of a called
+    /// function, 0 for anything else.
+    line_t line;
+    clock_t::time_point start;
+    clock_t::duration duration;
+  };
+  class Ring;
+  /// @brief records one span from construction to destruction, if a tracer
+  /// is running; otherwise it costs a single branch.
+  class Span {
+  public:
+    explicit Span(const string_view_type name, const line_t line = 0) noexcept {
+      if (const auto tracer = active.load(std::memory_order_acquire))
+          [[unlikely]]
+        begin(*tracer, name, line);
+    }
+    Span(const Span &) = delete;
+    auto operator=(const Span &) = delete;
+    ~Span() noexcept {
+      if (my_ring) [[unlikely]]
+        end();
+    }
+
+  private:
+    void begin(Tracer &, string_view_type, line_t) noexcept;
+    void end() noexcept;
+
+  private:
+    Ring *my_ring = nullptr;
+    /// @brief the run of the tracer @link my_ring @endlink belongs to.
+    std::uint64_t my_serial = 0;
+    string_view_type my_name;
+    line_t my_line = 0;
+    bool my_recorded = false;
+    clock_t::time_point my_start;
+  };
+
+public:
+  Tracer();
+  explicit Tracer(const Options &);
+  Tracer(const Tracer &) = delete;
+  auto operator=(const Tracer &) = delete;
+  ~Tracer();
+
+public:
+  /// @brief start recording; a tracer may be started again after @link stop
+  /// @endlink, the spans still open from the last run are then dropped.
+  auto start() -> utils::Status;
+  void stop() noexcept;
+  /// @brief the recorded events as a trace-event JSON object.
+  /// @pre the tracer is stopped and the traced threads are done with it.
+  auto to_json() const -> string_type;
+  auto write(const path_type &) const -> utils::Status;
+
+private:
+  /// @brief the ring of the calling thread, created on its first span.
+  auto ring() -> Ring &;
+
+private:
+  static inline constinit std::atomic<Tracer *> active = nullptr;
+
+private:
+  Options my_options;
+  /// @brief tells the runs of the tracers apart, even if one tracer reuses
+  /// another's address; 0 until the first @link start @endlink.
+  std::uint64_t my_serial = 0;
+  clock_t::time_point my_epoch;
+  mutable std::mutex my_rings_mutex;
+  std::vector<std::unique_ptr<Ring>> my_rings;
+};
+} // namespace net::ancillarycat::loxo
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <net/ancillarycat/utils/SmallVector.hpp>
 #include <net/ancillarycat/utils/Status.hpp>
 #include "loxo_fwd.hpp"
 
@@ -15,6 +16,9 @@ public:
                                loxo::evaluation::String,
                                loxo::evaluation::Callable>;
   using eval_result_t = StatusOr<variant_type>;
+  /// @brief arguments of a call are kept inline up to this count.
+  static constexpr std::size_t kInlineArgs = 8;
+  using args_t = SmallVector<variant_type, kInlineArgs>;
   using string_view_type = utils::Viewable::string_view_type;
 };
 } // namespace net::ancillarycat::utils
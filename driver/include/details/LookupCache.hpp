@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "loxo_fwd.hpp"
+#include "IVisitor.hpp"
+
+namespace net::ancillarycat::loxo {
+class Upvalue;
+/// @brief a monomorphic inline cache of a variable lookup, kept on the
+/// @link expression::Variable @endlink and @link expression::Assignment
+/// @endlink nodes themselves.
+/// @note scopes are lexical and declarations only appear directly in blocks,
+/// so the environments between a node and its binding contain the same names
+/// whenever they contain the same @a number of bindings. Hence on a hit we
+/// only compare binding counts while walking @link depth @endlink parents,
+/// and hash the name only if the environment holding the binding is not the
+/// one we saw last time (e.g. a fresh call frame).
+struct LookupCache {
+  using variant_type = utils::IVisitor::variant_type;
+  using string_type = std::string;
+  /// @brief deeper bindings are looked up the slow way.
+  static constexpr std::size_t kMaxDepth = 8;
+
+  /// @brief the variable name, converted from the token once.
+  string_type name;
+  /// @brief number of `parent` hops to the environment holding the binding;
+  /// @link kMaxDepth @endlink if nothing is cached.
+  std::uint32_t depth = kMaxDepth;
+  /// @brief serial of the environment holding the binding.
+  std::uint64_t serial = 0;
+  /// @brief the binding, unless it is captured from an enclosing function.
+  variant_type *value = nullptr;
+  /// @brief the captured binding; kept instead of its value, which moves
+  /// into the upvalue once the declaring frame returns.
+  Upvalue *upvalue = nullptr;
+  /// @brief binding counts of the environments in front of the binding.
+  std::array<std::uint32_t, kMaxDepth> counts{};
+
+  auto is_valid() const noexcept -> bool { return depth < kMaxDepth; }
+  void invalidate() noexcept {
+    depth = kMaxDepth;
+    value = nullptr;
+    upvalue = nullptr;
+  }
+  /// @pre @link is_valid @endlink
+  auto get() const noexcept -> variant_type *;
+};
+} // namespace net::ancillarycat::loxo
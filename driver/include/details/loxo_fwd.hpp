@@ -39,6 +39,7 @@ class interpreter;
 class Environment;
 
 class Resolver;
+class Instrumentation;
 // NOLINTBEGIN(bugprone-forward-declaration-namespace)
 namespace expression {
 class Expr;
@@ -64,6 +65,7 @@ class If;
 class While;
 class For;
 class Function;
+class LazyBody;
 class Return;
 class IllegalStmt;
 
@@ -77,6 +79,7 @@ class Value;
 class Boolean;
 class Nil;
 class Callable;
+struct FunctionPrototype;
 
 class ScopeAssoc;
 } // namespace evaluation
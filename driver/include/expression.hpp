@@ -3,6 +3,7 @@
 #include <any>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -14,6 +15,8 @@
 #include "details/loxo_fwd.hpp"
 
 #include "details/IVisitor.hpp"
+#include "details/LookupCache.hpp"
+#include "Evaluatable.hpp"
 #include "Token.hpp"
 #include "parse_error.hpp"
 
@@ -30,10 +33,28 @@ public:
   using token_t = Token;
   using expr_ptr_t = std::shared_ptr<base_type>;
   using expr_result_t = utils::IVisitor::eval_result_t;
+  /// @brief the concrete type of the node; lets code that walks whole trees,
+  /// e.g. @link ASTWriter @endlink, switch over it instead of visiting.
+  enum class Kind : std::uint8_t {
+    kLiteral,
+    kUnary,
+    kBinary,
+    kVariable,
+    kGrouping,
+    kAssignment,
+    kLogical,
+    kCall,
+  };
+
+protected:
+  explicit constexpr Expr(const Kind kind) noexcept : kind(kind) {}
 
 public:
   virtual ~Expr() = default;
 
+public:
+  const Kind kind;
+
 public:
   template <typename DerivedVisitor>
     requires std::is_base_of_v<ExprVisitor, DerivedVisitor>
@@ -57,6 +78,9 @@ private:
 
 public:
   token_t literal;
+  /// @brief the runtime value, materialized once when the node is built;
+  /// empty (@link utils::Monostate @endlink) if the token is not a literal.
+  utils::IVisitor::variant_type value;
 };
 /// @implements Expr
 class Unary : public Expr {
@@ -76,6 +100,23 @@ public:
 };
 
 class Binary : public Expr {
+public:
+  /// @brief what the node has specialized itself to after observing the
+  /// types of its operands.
+  enum class Specialization : std::uint8_t {
+    kGeneric = 0,
+    kNumberAdd,
+    kNumberSubtract,
+    kNumberMultiply,
+    kNumberDivide,
+    kNumberLess,
+    kNumberLessEqual,
+    kNumberGreater,
+    kNumberGreaterEqual,
+    kStringConcat,
+  };
+  /// @brief a node whose guard failed this many times stays generic.
+  static constexpr std::uint8_t kMaxDeopts = 4;
 
 public:
   explicit Binary(token_t &&, expr_ptr_t &&, expr_ptr_t &&);
@@ -90,6 +131,8 @@ public:
   token_t op;
   expr_ptr_t left;
   expr_ptr_t right;
+  mutable Specialization specialization = Specialization::kGeneric;
+  mutable std::uint8_t deopts = 0;
 };
 
 class Variable : public Expr {
@@ -99,6 +142,7 @@ public:
 
 public:
   token_t name;
+  mutable LookupCache cache;
 
 private:
   auto accept_impl(const ExprVisitor &) const -> expr_result_t override;
@@ -122,13 +166,13 @@ public:
 /// @implements Expr
 class Assignment : public Expr {
 public:
-  constexpr Assignment() = default;
   explicit Assignment(token_t &&, expr_ptr_t &&);
   virtual ~Assignment() override = default;
 
 public:
   token_t name;
   expr_ptr_t value_expr;
+  mutable LookupCache cache;
 
 private:
   virtual auto accept_impl(const ExprVisitor &) const -> expr_result_t override;
@@ -138,7 +182,6 @@ private:
 /// @implements Expr
 class Logical : public Expr {
 public:
-  constexpr Logical() = default;
   explicit Logical(token_t &&, expr_ptr_t &&, expr_ptr_t &&);
   virtual ~Logical() override = default;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <expected>
 #include <utility>
 #include <span>
@@ -23,7 +24,8 @@ class LOXO_API interpreter : virtual public expression::ExprVisitor,
                               std::enable_shared_from_this<interpreter>{
 public:
   interpreter();
-  virtual ~interpreter() override = default;
+  /// @brief clears the globals: a function declared there refers to them.
+  virtual ~interpreter() override;
   using ostringstream_t = std::ostringstream;
   using env_t = Environment;
   using env_ptr_t = std::shared_ptr<env_t>;
@@ -34,9 +36,15 @@ public:
   auto set_env(const env_ptr_t &) const -> const interpreter &;
   // auto restore_env() const -> const interpreter &;
   auto get_current_env() const { return env; }
-  // auto get_global_env() const -> std::weak_ptr<Environment> {
-  //   return global_env;
-  // }
+  /// @brief count every statement and call into @p instrumentation, or stop
+  /// counting if it is null.
+  auto set_instrumentation(Instrumentation *) const -> const interpreter &;
+  auto get_instrumentation() const { return instrumentation; }
+  /// @brief the output of the statements interpreted so far, which is then
+  /// dropped; lets a long-lived interpreter hand its output out piecewise.
+  auto take_output() const -> string_type;
+  /// @brief the globals of this interpreter, which no other one shares.
+  auto get_global_env() const { return global_env; }
 
 private:
   virtual auto visit_impl(const expression::Literal &) const
@@ -67,8 +75,19 @@ private:
   evaluation::Boolean is_true_value(const eval_result_t &) const;
   evaluation::Boolean is_deep_equal(const eval_result_t &,
                                     const eval_result_t &) const;
-  auto get_call_args(const expression::Call &expr) const
-      -> utils::StatusOr<std::vector<variant_type>>;
+  /// @brief the fast path of a @link expression::Binary @endlink that has
+  /// specialized itself; empty if its guard failed, in which case the node is
+  /// deoptimized and the generic path runs instead.
+  auto eval_specialized(const expression::Binary &,
+                        const eval_result_t &,
+                        const eval_result_t &) const
+      -> std::optional<variant_type>;
+  /// @brief specialize the node after the generic path succeeded.
+  void quicken(const expression::Binary &, const eval_result_t &) const;
+  /// @brief evaluates the arguments of @p expr into @p args, which is usually
+  /// either a small on-stack buffer or the slots of the callee's frame.
+  auto get_call_args(const expression::Call &expr, args_t &args) const
+      -> utils::Status;
 
 private:
   virtual auto visit_impl(const statement::Variable &) const
@@ -98,8 +117,9 @@ private:
   mutable eval_result_t last_expr_res{utils::Monostate{}};
   mutable std::vector<eval_result_t> stmts_res{};
   mutable env_ptr_t env{};
+  const env_ptr_t global_env;
+  mutable Instrumentation *instrumentation = nullptr;
   // mutable env_ptr_t prev_env{};
-  // mutable env_ptr_t global_env{};
   // temporary fix, is it's true, do not `to_string` for last_expr.
   mutable bool is_interpreting_stmts = false;
 
@@ -47,7 +47,9 @@ public:
   /// @return OkStatus() if successful, NotFoundError() otherwise
   status_t load(const path_type &) const;
   /// @copydoc load(const path_type &)
-  status_t load(const std::istream &);
+  /// @param first_line the line the contents start at, for sources that are
+  /// fed piece by piece.
+  status_t load(const std::istream &, uint_least32_t first_line = 1);
   /// @brief lex the contents of the file
   /// @return OkStatus() if successful, NotFoundError() otherwise
   status_t lex();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <source_location>
@@ -23,6 +24,20 @@ public:
     kStatement = 0,
     kExpression = 1,
   };
+  /// @brief when the bodies of functions are parsed.
+  enum class FunctionBodies : std::uint8_t {
+    /// @brief along with the rest of the program.
+    kEager,
+    /// @brief on the first call, by @link statement::LazyBody @endlink; until
+    /// then only the braces are matched, so a syntax error inside a body is
+    /// reported by the first call, if any.
+    kLazy,
+    /// @brief on the first call too, but checked once up front so that the
+    /// errors are those of @link kEager @endlink; the tree built by the check
+    /// is dropped, which saves the memory of the bodies never called but not
+    /// the time to parse them.
+    kLazyChecked,
+  };
 
 public:
   using token_t = Token;
@@ -42,6 +57,7 @@ public:
 public:
   parser() = default;
   parser &set_views(token_views_t = {});
+  parser &set_function_bodies(FunctionBodies) noexcept;
   /// @brief main entry point for parsing.
   /// @note Expression needs to be shared; especially for variables.
   ///  `(a + b) * (a + b)`. `(a + b)` is shared. `std::unique_ptr` may
@@ -49,6 +65,10 @@ public:
   auto parse(const ParsePolicy &) -> utils::Status;
   auto get_statements() const -> stmt_ptrs_t &;
   auto get_expression() const -> expr_ptr_t &;
+  /// @brief parse the tokens of a @link statement::LazyBody @endlink into
+  /// @p statements; the functions declared inside stay lazy.
+  static auto parse_body(token_views_t, stmt_ptrs_t &statements)
+      -> utils::Status;
 
 private:
   auto next_expression() -> expr_ptr_t;
@@ -67,6 +87,9 @@ private:
   auto get_args() -> std::vector<expr_ptr_t>;
   auto get_params() -> std::vector<token_t>;
   auto get_stmts() -> stmt_ptrs_t;
+  /// @brief move past the '}' closing the body just opened, matching the
+  /// braces in between only.
+  void skip_body();
 
 private:
   auto next_declaration() -> stmt_ptr_t;
@@ -90,6 +113,10 @@ private:
 private:
   /// @remark used in @link while_stmt @endlink and @link if_stmt @endlink
   auto get_condition() -> expr_ptr_t;
+  /// @brief @link std::make_shared @endlink for AST nodes; also counts them
+  /// for `--stats`.
+  template <typename NodeTy, typename... Args>
+  static auto make_node(Args &&...) -> std::shared_ptr<NodeTy>;
 
 private:
   template <typename... Args>
@@ -115,6 +142,7 @@ private:
   token_views_t::iterator cursor{};
   mutable expr_ptr_t expr_head = nullptr;
   mutable stmt_ptrs_t stmts = {};
+  FunctionBodies function_bodies = FunctionBodies::kEager;
   // bool is_in_panic = false;
 private:
   friend LOXO_API void delete_parser_fwd(parser *);
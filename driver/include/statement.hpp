@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "details/loxo_fwd.hpp"
@@ -19,10 +21,31 @@ public:
   using stmt_ptr_t = std::shared_ptr<base_type>;
   using expr_ptr_t = std::shared_ptr<expression::Expr>;
   using stmt_result_t = utils::Status;
+  /// @brief the concrete type of the node; see @link expression::Expr::Kind
+  /// @endlink
+  enum class Kind : std::uint8_t {
+    kVariable,
+    kPrint,
+    kExpression,
+    kBlock,
+    kIf,
+    kWhile,
+    kFor,
+    kFunction,
+    kReturn,
+  };
+
+protected:
+  explicit constexpr Stmt(const Kind kind) noexcept : kind(kind) {}
 
 public:
   virtual ~Stmt() = default;
 
+public:
+  const Kind kind;
+  /// @brief the line of the first token of the statement; set by the parser.
+  uint_least32_t line = 0;
+
 public:
   template <typename DerivedVisitor>
     requires std::is_base_of_v<StmtVisitor, DerivedVisitor>
@@ -37,7 +60,8 @@ class Variable : public Stmt {
 public:
   // TODO: move or copy the token or reference it?
   Variable(Token name, expr_ptr_t initializer)
-      : name(std::move(name)), initializer(std::move(initializer)) {}
+      : Stmt(Kind::kVariable), name(std::move(name)),
+        initializer(std::move(initializer)) {}
   virtual ~Variable() override = default;
 
 public:
@@ -56,8 +80,8 @@ private:
 };
 class Print : public Stmt {
 public:
-  constexpr Print() = default;
-  explicit Print(expr_ptr_t &&value) : value(std::move(value)) {}
+  explicit Print(expr_ptr_t &&value)
+      : Stmt(Kind::kPrint), value(std::move(value)) {}
   virtual ~Print() override = default;
 
 public:
@@ -71,8 +95,8 @@ private:
 };
 class Expression : public Stmt {
 public:
-  constexpr Expression() = default;
-  explicit Expression(expr_ptr_t &&expr) : expr(std::move(expr)) {}
+  explicit Expression(expr_ptr_t &&expr)
+      : Stmt(Kind::kExpression), expr(std::move(expr)) {}
   virtual ~Expression() override = default;
 
 public:
@@ -86,9 +110,8 @@ private:
 };
 class Block : public Stmt {
 public:
-  constexpr Block() = default;
   explicit Block(std::vector<stmt_ptr_t> &&statements)
-      : statements(std::move(statements)) {}
+      : Stmt(Kind::kBlock), statements(std::move(statements)) {}
   virtual ~Block() override = default;
 
 public:
@@ -102,11 +125,11 @@ private:
 
 class If : public Stmt {
 public:
-  constexpr If() = default;
   explicit If(expr_ptr_t &&condition,
               stmt_ptr_t &&then_branch,
               stmt_ptr_t &&else_branch)
-      : condition(std::move(condition)), then_branch(std::move(then_branch)),
+      : Stmt(Kind::kIf), condition(std::move(condition)),
+        then_branch(std::move(then_branch)),
         else_branch(std::move(else_branch)) {}
   virtual ~If() = default;
 
@@ -123,9 +146,9 @@ private:
 
 class While : public Stmt {
 public:
-  constexpr While() = default;
   explicit While(expr_ptr_t &&condition, stmt_ptr_t &&body)
-      : condition(std::move(condition)), body(std::move(body)) {}
+      : Stmt(Kind::kWhile), condition(std::move(condition)),
+        body(std::move(body)) {}
   virtual ~While() = default;
 
 public:
@@ -139,13 +162,13 @@ private:
 };
 class For : public Stmt {
 public:
-  constexpr For() = default;
   explicit For(stmt_ptr_t &&initializer,
                expr_ptr_t &&condition,
                expr_ptr_t &&increment,
                stmt_ptr_t &&body)
-      : initializer(std::move(initializer)), condition(std::move(condition)),
-        increment(std::move(increment)), body(std::move(body)) {}
+      : Stmt(Kind::kFor), initializer(std::move(initializer)),
+        condition(std::move(condition)), increment(std::move(increment)),
+        body(std::move(body)) {}
   virtual ~For() = default;
 
 public:
@@ -159,20 +182,72 @@ private:
       -> string_type override;
   auto accept_impl(const StmtVisitor &) const -> stmt_result_t override;
 };
+/// @brief the tokens of a function body the parser left alone, parsed into
+/// statements on the first call; see @link parser::FunctionBodies @endlink.
+/// @note the tokens are copies, so the lexer may go before the first call.
+class LOXO_API LazyBody {
+public:
+  using token_t = Token;
+  using string_type = std::string;
+  using stmt_ptrs_t = std::vector<std::shared_ptr<Stmt>>;
+
+public:
+  /// @param tokens the body between the braces, followed by an EOF token.
+  explicit LazyBody(std::vector<token_t> &&tokens);
+  /// @brief the literals view the lexemes of this very body.
+  LazyBody(const LazyBody &) = delete;
+  auto operator=(const LazyBody &) = delete;
+
+public:
+  /// @brief parse the body unless that was done before; a syntax error is
+  /// returned again on every later call.
+  auto parse() -> utils::Status;
+  auto is_parsed() const noexcept -> bool { return my_parsed; }
+  /// @brief empty until @link parse @endlink succeeds.
+  auto statements() const noexcept -> const stmt_ptrs_t & {
+    return my_statements;
+  }
+  /// @brief the names the unparsed body mentions, once each.
+  auto identifiers() const -> std::vector<string_type>;
+
+private:
+  std::vector<token_t> my_tokens;
+  stmt_ptrs_t my_statements;
+  utils::Status my_status;
+  bool my_parsed = false;
+};
 class Function : public Stmt {
 public:
-  constexpr Function() = default;
   explicit Function(token_t &&name,
                     std::vector<token_t> &&parameters,
                     std::vector<stmt_ptr_t> &&body)
-      : name(std::move(name)), parameters(std::move(parameters)),
-        body(std::move(body)) {}
+      : Stmt(Kind::kFunction), name(std::move(name)),
+        parameters(std::move(parameters)), body(std::move(body)) {}
+  explicit Function(token_t &&name,
+                    std::vector<token_t> &&parameters,
+                    std::shared_ptr<LazyBody> &&body)
+      : Stmt(Kind::kFunction), name(std::move(name)),
+        parameters(std::move(parameters)), body(std::vector<stmt_ptr_t>{}),
+        lazy_body(std::move(body)) {}
   virtual ~Function() = default;
 
+public:
+  /// @brief the statements of the body, from @link lazy_body @endlink if
+  /// there is one; empty until that is parsed.
+  auto statements() const noexcept -> const std::vector<stmt_ptr_t> & {
+    return lazy_body ? lazy_body->statements() : body.statements;
+  }
+
 public:
   token_t name;
   std::vector<token_t> parameters;
   Block body;
+  /// @brief set instead of @link body @endlink when the parser left the body
+  /// for the first call.
+  std::shared_ptr<LazyBody> lazy_body;
+  /// @brief built the first time the declaration is executed and shared by
+  /// every closure created from it afterwards.
+  mutable std::shared_ptr<const evaluation::FunctionPrototype> prototype;
 
 private:
   auto to_string_impl(const utils::FormatPolicy &) const
@@ -182,8 +257,8 @@ private:
 
 class Return : public Stmt {
 public:
-  constexpr Return() = default;
-  explicit Return(expr_ptr_t &&value) : value(std::move(value)) {}
+  explicit Return(expr_ptr_t &&value)
+      : Stmt(Kind::kReturn), value(std::move(value)) {}
   virtual ~Return() = default;
 
 public:
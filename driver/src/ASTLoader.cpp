@@ -0,0 +1,494 @@
+#include <any>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/Status.hpp>
+#include <net/ancillarycat/utils/json.hpp>
+
+#include "details/loxo_fwd.hpp"
+#include "ASTWriter.hpp"
+#include "Token.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+
+#include "ASTLoader.hpp"
+
+namespace net::ancillarycat::loxo {
+namespace {
+namespace json = utils::json;
+using Tag = ASTWriter::Tag;
+using string_view_type = ASTLoader::string_view_type;
+using stmt_ptr_t = ASTLoader::stmt_ptr_t;
+using expr_ptr_t = std::shared_ptr<expression::Expr>;
+
+/// @brief thrown on malformed input; @link ASTLoader::load @endlink turns it
+/// into a status.
+struct load_error {
+  std::string message;
+};
+[[noreturn]] void fail(std::string message) {
+  throw load_error{std::move(message)};
+}
+
+/// @brief a token as stored, before its literal value is rebuilt.
+struct RawToken {
+  TokenType::type_t type = TokenType::kMonostate;
+  std::string lexeme;
+  uint_least32_t line = 0;
+};
+auto token_type(const std::uint64_t value) -> TokenType::type_t {
+  if (value > TokenType::kEndOfFile)
+    fail("unknown token type " + std::to_string(value));
+  return static_cast<TokenType::type_t>(value);
+}
+auto token_type(const string_view_type name) -> TokenType::type_t {
+  for (auto value = 0u; value <= TokenType::kEndOfFile; ++value)
+    if (format_as(TokenType{static_cast<TokenType::type_t>(value)}) == name)
+      return static_cast<TokenType::type_t>(value);
+  fail("unknown token type " + std::string{name});
+}
+auto line_number(const std::uint64_t value) -> uint_least32_t {
+  if (value > std::numeric_limits<uint_least32_t>::max())
+    fail("line number out of range");
+  return static_cast<uint_least32_t>(value);
+}
+
+/// @brief reads the binary form front to back; the field names are implied
+/// by the order the @link Builder @endlink asks for them in.
+class BinarySource {
+public:
+  explicit BinarySource(const string_view_type data) noexcept : data(data) {}
+
+public:
+  auto program() -> std::size_t {
+    if (!data.starts_with(ASTWriter::kMagic))
+      fail("not a binary AST");
+    pos = ASTWriter::kMagic.size();
+    if (const auto version = byte(); version != ASTWriter::kVersion)
+      fail("unsupported version " + std::to_string(version));
+    return list();
+  }
+  auto tag() -> Tag { return static_cast<Tag>(byte()); }
+  auto line() -> uint_least32_t { return line_number(varint()); }
+  void field(string_view_type) {}
+  void item(std::size_t) {}
+  auto list() -> std::size_t {
+    // every item takes a byte at least.
+    const auto count = varint();
+    if (count > data.size() - pos)
+      fail("list longer than the input");
+    return static_cast<std::size_t>(count);
+  }
+  void end() {}
+  auto token() -> RawToken {
+    auto token = RawToken{};
+    token.type = token_type(byte());
+    const auto size = varint();
+    if (size > data.size() - pos)
+      fail("lexeme longer than the input");
+    token.lexeme = data.substr(pos, static_cast<std::size_t>(size));
+    pos += static_cast<std::size_t>(size);
+    token.line = line_number(varint());
+    return token;
+  }
+  void finish() {
+    if (pos != data.size())
+      fail("trailing bytes after the program");
+  }
+
+private:
+  auto byte() -> std::uint8_t {
+    if (pos >= data.size())
+      fail("unexpected end of input");
+    return static_cast<std::uint8_t>(data[pos++]);
+  }
+  auto varint() -> std::uint64_t {
+    auto value = std::uint64_t{};
+    for (auto shift = 0; shift < 64; shift += 7) {
+      const auto next = byte();
+      value |= static_cast<std::uint64_t>(next & 0x7f) << shift;
+      if (!(next & 0x80))
+        return value;
+    }
+    fail("varint too long");
+  }
+
+private:
+  string_view_type data;
+  std::size_t pos = 0;
+};
+
+/// @brief reads the JSON form; a field is looked up by name in the node being
+/// read, so the order of the keys does not matter.
+class JsonSource {
+public:
+  /// @brief a node takes up to three levels: itself, a field and a list.
+  static constexpr std::size_t kMaxDepth = 3 * ASTLoader::kMaxDepth + 8;
+
+public:
+  explicit JsonSource(const json::Value &root) noexcept : root(root) {}
+
+public:
+  auto program() -> std::size_t {
+    if (const auto format = root.find("format");
+        !format || format->string() != ASTWriter::kJsonFormat)
+      fail("not a JSON AST");
+    if (const auto version = root.find("version");
+        !version || version->number() != ASTWriter::kVersion)
+      fail("unsupported version");
+    next = root.find("statements");
+    if (!next)
+      fail("missing field 'statements'");
+    return list();
+  }
+  auto tag() -> Tag {
+    const auto &value = take();
+    if (value.is_null())
+      return Tag::kNone;
+    const auto node = value.find("node");
+    const auto name = node ? node->string() : std::nullopt;
+    if (!name)
+      fail("expected a node");
+    for (auto tag_value = 1u; tag_value <= static_cast<unsigned>(Tag::kReturn);
+         ++tag_value)
+      if (const auto tag = static_cast<Tag>(tag_value);
+          !ASTWriter::name_of(tag).empty() &&
+          ASTWriter::name_of(tag) == *name) {
+        stack.push_back(&value);
+        return tag;
+      }
+    fail("unknown node '" + std::string{*name} + "'");
+  }
+  auto line() -> uint_least32_t {
+    return line_number(integer(stack.back()->find("line"), "line"));
+  }
+  void field(const string_view_type name) {
+    next = stack.back()->find(name);
+    if (!next)
+      fail("missing field '" + std::string{name} + "'");
+  }
+  void item(const std::size_t index) {
+    next = &stack.back()->as_array()[index];
+  }
+  auto list() -> std::size_t {
+    const auto &value = take();
+    if (!value.is_array())
+      fail("expected a list");
+    stack.push_back(&value);
+    return value.as_array().size();
+  }
+  void end() { stack.pop_back(); }
+  auto token() -> RawToken {
+    const auto &value = take();
+    const auto type = value.find("type");
+    const auto lexeme = value.find("lexeme");
+    if (!type || !lexeme || !type->string() || !lexeme->string())
+      fail("expected a token");
+    return {token_type(*type->string()),
+            std::string{*lexeme->string()},
+            line_number(integer(value.find("line"), "line"))};
+  }
+  void finish() {}
+
+private:
+  auto take() -> const json::Value & {
+    contract_assert(next)
+    return *std::exchange(next, nullptr);
+  }
+  static auto integer(const json::Value *value, const string_view_type name)
+      -> std::uint64_t {
+    const auto number = value ? value->number() : std::nullopt;
+    if (!number || *number < 0 || *number >= 0x1p64 ||
+        *number != static_cast<double>(static_cast<std::uint64_t>(*number)))
+      fail("expected a whole number for '" + std::string{name} + "'");
+    return static_cast<std::uint64_t>(*number);
+  }
+
+private:
+  const json::Value &root;
+  std::vector<const json::Value *> stack;
+  const json::Value *next = nullptr;
+};
+
+/// @brief builds the nodes out of what @p Source reads, asking for the fields
+/// in the order @link ASTWriter @endlink writes them.
+template <typename Source> class Builder {
+public:
+  explicit Builder(Source &in) noexcept : in(in) {}
+
+public:
+  auto program() -> ASTLoader::stmt_ptrs_t {
+    auto statements = ASTLoader::stmt_ptrs_t(in.program());
+    for (auto i = std::size_t{}; i < statements.size(); ++i) {
+      in.item(i);
+      statements[i] = required(stmt(0), "statement");
+    }
+    in.end();
+    in.finish();
+    return statements;
+  }
+
+private:
+  auto stmt(const std::size_t depth) -> stmt_ptr_t {
+    if (depth > ASTLoader::kMaxDepth)
+      fail("program nested too deeply");
+    const auto tag = in.tag();
+    if (tag == Tag::kNone)
+      return nullptr;
+    const auto line = in.line();
+    auto node = stmt_ptr_t{};
+    switch (tag) {
+    case Tag::kVar: {
+      auto name = field_token("name", TokenType::kIdentifier);
+      auto initializer = field_expr("initializer", depth);
+      node = std::make_shared<statement::Variable>(std::move(name),
+                                                   std::move(initializer));
+      break;
+    }
+    case Tag::kPrint:
+      node = std::make_shared<statement::Print>(
+          required(field_expr("value", depth), "Print.value"));
+      break;
+    case Tag::kExpression:
+      node = std::make_shared<statement::Expression>(
+          required(field_expr("expression", depth), "Expression.expression"));
+      break;
+    case Tag::kBlock:
+      node =
+          std::make_shared<statement::Block>(field_stmts("statements", depth));
+      break;
+    case Tag::kIf: {
+      auto condition = required(field_expr("condition", depth), "If.condition");
+      auto then_branch = required(field_stmt("then", depth), "If.then");
+      auto else_branch = field_stmt("else", depth);
+      node = std::make_shared<statement::If>(std::move(condition),
+                                             std::move(then_branch),
+                                             std::move(else_branch));
+      break;
+    }
+    case Tag::kWhile: {
+      auto condition =
+          required(field_expr("condition", depth), "While.condition");
+      auto body = required(field_stmt("body", depth), "While.body");
+      node = std::make_shared<statement::While>(std::move(condition),
+                                                std::move(body));
+      break;
+    }
+    case Tag::kFor: {
+      auto initializer = field_stmt("initializer", depth);
+      auto condition = field_expr("condition", depth);
+      auto increment = field_expr("increment", depth);
+      auto body = required(field_stmt("body", depth), "For.body");
+      node = std::make_shared<statement::For>(std::move(initializer),
+                                              std::move(condition),
+                                              std::move(increment),
+                                              std::move(body));
+      break;
+    }
+    case Tag::kFunction: {
+      auto name = field_token("name", TokenType::kIdentifier);
+      in.field("parameters");
+      auto parameters = std::vector<Token>(in.list());
+      for (auto i = std::size_t{}; i < parameters.size(); ++i) {
+        in.item(i);
+        parameters[i] = token(TokenType::kIdentifier);
+      }
+      in.end();
+      auto body = field_stmts("body", depth);
+      node = std::make_shared<statement::Function>(
+          std::move(name), std::move(parameters), std::move(body));
+      break;
+    }
+    case Tag::kReturn:
+      node = std::make_shared<statement::Return>(field_expr("value", depth));
+      break;
+    default:
+      fail("expected a statement, got '" +
+           std::string{ASTWriter::name_of(tag)} + "'");
+    }
+    node->line = line;
+    in.end();
+    return node;
+  }
+  auto expr(const std::size_t depth) -> expr_ptr_t {
+    if (depth > ASTLoader::kMaxDepth)
+      fail("program nested too deeply");
+    const auto tag = in.tag();
+    if (tag == Tag::kNone)
+      return nullptr;
+    auto node = expr_ptr_t{};
+    switch (tag) {
+    case Tag::kLiteral:
+      in.field("token");
+      node = std::make_shared<expression::Literal>(literal());
+      break;
+    case Tag::kUnary: {
+      auto op = field_token("operator");
+      auto operand = required(field_expr("operand", depth), "Unary.operand");
+      node = std::make_shared<expression::Unary>(std::move(op),
+                                                 std::move(operand));
+      break;
+    }
+    case Tag::kBinary:
+    case Tag::kLogical: {
+      auto op = field_token("operator");
+      auto left = required(field_expr("left", depth), "left operand");
+      auto right = required(field_expr("right", depth), "right operand");
+      if (tag == Tag::kBinary)
+        node = std::make_shared<expression::Binary>(
+            std::move(op), std::move(left), std::move(right));
+      else
+        node = std::make_shared<expression::Logical>(
+            std::move(op), std::move(left), std::move(right));
+      break;
+    }
+    case Tag::kVariable:
+      node = std::make_shared<expression::Variable>(
+          field_token("name", TokenType::kIdentifier));
+      break;
+    case Tag::kGrouping:
+      node = std::make_shared<expression::Grouping>(
+          required(field_expr("expression", depth), "Grouping.expression"));
+      break;
+    case Tag::kAssignment: {
+      auto name = field_token("name", TokenType::kIdentifier);
+      auto value = required(field_expr("value", depth), "Assignment.value");
+      node = std::make_shared<expression::Assignment>(std::move(name),
+                                                      std::move(value));
+      break;
+    }
+    case Tag::kCall: {
+      auto callee = required(field_expr("callee", depth), "Call.callee");
+      auto paren = field_token("paren");
+      in.field("arguments");
+      auto args = std::vector<expr_ptr_t>(in.list());
+      for (auto i = std::size_t{}; i < args.size(); ++i) {
+        in.item(i);
+        args[i] = required(expr(depth + 1), "argument");
+      }
+      in.end();
+      node = std::make_shared<expression::Call>(
+          std::move(callee), std::move(paren), std::move(args));
+      break;
+    }
+    default:
+      fail("expected an expression, got '" +
+           std::string{ASTWriter::name_of(tag)} + "'");
+    }
+    in.end();
+    return node;
+  }
+  auto field_stmt(const string_view_type name, const std::size_t depth)
+      -> stmt_ptr_t {
+    in.field(name);
+    return stmt(depth + 1);
+  }
+  auto field_stmts(const string_view_type name, const std::size_t depth)
+      -> std::vector<stmt_ptr_t> {
+    in.field(name);
+    auto statements = std::vector<stmt_ptr_t>(in.list());
+    for (auto i = std::size_t{}; i < statements.size(); ++i) {
+      in.item(i);
+      statements[i] = required(stmt(depth + 1), "statement");
+    }
+    in.end();
+    return statements;
+  }
+  auto field_expr(const string_view_type name, const std::size_t depth)
+      -> expr_ptr_t {
+    in.field(name);
+    return expr(depth + 1);
+  }
+  auto field_token(const string_view_type name,
+                   const TokenType::type_t expected = TokenType::kMonostate)
+      -> Token {
+    in.field(name);
+    return token(expected);
+  }
+  /// @param expected the type the token must have; any if kMonostate.
+  auto token(const TokenType::type_t expected = TokenType::kMonostate)
+      -> Token {
+    auto raw = in.token();
+    if (expected != TokenType::kMonostate && raw.type != expected)
+      fail("expected " + std::string{format_as(TokenType{expected})} +
+           ", got " + std::string{format_as(TokenType{raw.type})});
+    return Token{raw.type, std::move(raw.lexeme), std::any{}, raw.line};
+  }
+  /// @brief the token of a literal, with its value rebuilt from the lexeme
+  /// the way the lexer does.
+  auto literal() -> Token {
+    auto raw = in.token();
+    auto value = std::any{};
+    switch (raw.type) {
+    case TokenType::kNil:
+    case TokenType::kTrue:
+    case TokenType::kFalse:
+      break;
+    case TokenType::kString:
+      if (raw.lexeme.size() < 2 || raw.lexeme.front() != '"' ||
+          raw.lexeme.back() != '"')
+        fail("string literal without quotes");
+      // the value must outlive the node's construction, which interns it.
+      value = string_view_type{
+          strings.emplace_back(raw.lexeme.substr(1, raw.lexeme.size() - 2))};
+      break;
+    case TokenType::kNumber: {
+      auto number = 0.0L;
+      const auto &lexeme = raw.lexeme;
+      const auto [end, ec] = std::from_chars(
+          lexeme.data(), lexeme.data() + lexeme.size(), number);
+      if (ec != std::errc{} || end != lexeme.data() + lexeme.size())
+        fail("invalid number literal '" + lexeme + "'");
+      value = number;
+      break;
+    }
+    default:
+      fail("expected a literal, got " +
+           std::string{format_as(TokenType{raw.type})});
+    }
+    return Token{raw.type, std::move(raw.lexeme), std::move(value), raw.line};
+  }
+  template <typename Ptr>
+  static auto required(Ptr &&node, const string_view_type what) -> Ptr {
+    if (!node)
+      fail("missing " + std::string{what});
+    return std::forward<Ptr>(node);
+  }
+
+private:
+  Source &in;
+  std::deque<std::string> strings;
+};
+} // namespace
+
+auto ASTLoader::load(const string_view_type data) -> utils::Status {
+  try {
+    if (data.starts_with(ASTWriter::kMagic)) {
+      auto source = BinarySource{data};
+      my_statements = Builder{source}.program();
+    } else {
+      auto error = std::string{};
+      const auto document =
+          json::parse(data, &error, JsonSource::kMaxDepth);
+      if (!document)
+        fail(std::move(error));
+      auto source = JsonSource{*document};
+      my_statements = Builder{source}.program();
+    }
+  } catch (const load_error &error) {
+    my_statements.clear();
+    return utils::InvalidArgument("malformed AST: " + error.message);
+  }
+  return utils::OkStatus();
+}
+} // namespace net::ancillarycat::loxo
@@ -0,0 +1,439 @@
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+#include "Token.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+
+#include "ASTWriter.hpp"
+
+namespace net::ancillarycat::loxo {
+namespace {
+using Tag = ASTWriter::Tag;
+using string_view_type = ASTWriter::string_view_type;
+// the binary form stores token types by value.
+static_assert(TokenType::kEndOfFile == 40,
+              "the token types changed; bump ASTWriter::kVersion");
+
+auto tag_of(const expression::Expr::Kind kind) noexcept -> Tag {
+  using enum expression::Expr::Kind;
+  switch (kind) {
+  case kLiteral:
+    return Tag::kLiteral;
+  case kUnary:
+    return Tag::kUnary;
+  case kBinary:
+    return Tag::kBinary;
+  case kVariable:
+    return Tag::kVariable;
+  case kGrouping:
+    return Tag::kGrouping;
+  case kAssignment:
+    return Tag::kAssignment;
+  case kLogical:
+    return Tag::kLogical;
+  case kCall:
+    return Tag::kCall;
+  }
+  std::unreachable();
+}
+auto tag_of(const statement::Stmt::Kind kind) noexcept -> Tag {
+  using enum statement::Stmt::Kind;
+  switch (kind) {
+  case kVariable:
+    return Tag::kVar;
+  case kPrint:
+    return Tag::kPrint;
+  case kExpression:
+    return Tag::kExpression;
+  case kBlock:
+    return Tag::kBlock;
+  case kIf:
+    return Tag::kIf;
+  case kWhile:
+    return Tag::kWhile;
+  case kFor:
+    return Tag::kFor;
+  case kFunction:
+    return Tag::kFunction;
+  case kReturn:
+    return Tag::kReturn;
+  }
+  std::unreachable();
+}
+
+/// @brief appends the binary form; the field names are implied by the order.
+class BinaryEmitter {
+public:
+  explicit BinaryEmitter(std::string &out) noexcept : out(out) {}
+
+public:
+  void begin_program(const std::size_t count) {
+    out += ASTWriter::kMagic;
+    out += static_cast<char>(ASTWriter::kVersion);
+    varint(count);
+  }
+  void end_program() {}
+  void begin_node(const Tag tag) { out += static_cast<char>(tag); }
+  void line(const std::uint_least32_t line) { varint(line); }
+  void end_node() {}
+  void none() { out += static_cast<char>(Tag::kNone); }
+  void field(string_view_type) {}
+  void token(const Token &token) {
+    out += static_cast<char>(token.type.type);
+    varint(token.lexeme.size());
+    out += token.lexeme;
+    varint(token.line);
+  }
+  void begin_list(const std::size_t count) { varint(count); }
+  void item(std::size_t) {}
+  void end_list() {}
+
+private:
+  void varint(std::uint64_t value) {
+    for (; value >= 0x80; value >>= 7)
+      out += static_cast<char>((value & 0x7f) | 0x80);
+    out += static_cast<char>(value);
+  }
+
+private:
+  std::string &out;
+};
+
+/// @brief appends the JSON form, without any whitespace.
+class JsonEmitter {
+public:
+  explicit JsonEmitter(std::string &out) noexcept : out(out) {}
+
+public:
+  void begin_program(std::size_t) {
+    out += R"({"format":")";
+    out += ASTWriter::kJsonFormat;
+    out += R"(","version":)";
+    number(ASTWriter::kVersion);
+    out += R"(,"statements":[)";
+  }
+  void end_program() { out += "]}"; }
+  void begin_node(const Tag tag) {
+    out += R"({"node":")";
+    out += ASTWriter::name_of(tag);
+    out += '"';
+  }
+  void line(const std::uint_least32_t line) {
+    out += R"(,"line":)";
+    number(line);
+  }
+  void end_node() { out += '}'; }
+  void none() { out += "null"; }
+  void field(const string_view_type name) {
+    out += ",\"";
+    out += name;
+    out += "\":";
+  }
+  void token(const Token &token) {
+    out += R"({"type":")";
+    out += format_as(token.type);
+    out += R"(","lexeme":)";
+    string(token.lexeme);
+    out += R"(,"line":)";
+    number(token.line);
+    out += '}';
+  }
+  void begin_list(std::size_t) { out += '['; }
+  void item(const std::size_t index) {
+    if (index)
+      out += ',';
+  }
+  void end_list() { out += ']'; }
+
+private:
+  void number(const std::uint64_t value) {
+    char buffer[24];
+    const auto [end, _] = std::to_chars(buffer, buffer + sizeof buffer, value);
+    out.append(buffer, end);
+  }
+  void string(const string_view_type text) {
+    constexpr auto hex = "0123456789abcdef"sv;
+    out += '"';
+    for (const auto ch : text) {
+      switch (ch) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(ch) < 0x20) {
+          out += "\\u00";
+          out += hex[static_cast<unsigned char>(ch) >> 4];
+          out += hex[static_cast<unsigned char>(ch) & 0xf];
+        } else
+          out += ch; // UTF-8 passes through.
+      }
+    }
+    out += '"';
+  }
+
+private:
+  std::string &out;
+};
+
+/// @brief walks the tree in schema order and tells @p Emitter what it sees.
+template <typename Emitter> class Walker {
+public:
+  explicit Walker(Emitter &emitter) noexcept : emitter(emitter) {}
+
+public:
+  /// @return the first syntax error of a function body left for its first
+  /// call, if any; the program is written completely either way.
+  auto program(const std::span<const ASTWriter::stmt_ptr_t> statements)
+      -> utils::Status {
+    emitter.begin_program(statements.size());
+    for (auto i = std::size_t{}; i < statements.size(); ++i) {
+      emitter.item(i);
+      stmt(statements[i].get());
+    }
+    emitter.end_program();
+    return std::move(status);
+  }
+
+private:
+  void stmt(const statement::Stmt *const node) {
+    if (!node)
+      return emitter.none();
+    emitter.begin_node(tag_of(node->kind));
+    emitter.line(node->line);
+    using enum statement::Stmt::Kind;
+    switch (node->kind) {
+    case kVariable: {
+      const auto &var = static_cast<const statement::Variable &>(*node);
+      token("name", var.name);
+      expr("initializer", var.initializer.get());
+      break;
+    }
+    case kPrint:
+      expr("value", static_cast<const statement::Print &>(*node).value.get());
+      break;
+    case kExpression:
+      expr("expression",
+           static_cast<const statement::Expression &>(*node).expr.get());
+      break;
+    case kBlock:
+      stmts("statements",
+            static_cast<const statement::Block &>(*node).statements);
+      break;
+    case kIf: {
+      const auto &branch = static_cast<const statement::If &>(*node);
+      expr("condition", branch.condition.get());
+      stmt("then", branch.then_branch.get());
+      stmt("else", branch.else_branch.get());
+      break;
+    }
+    case kWhile: {
+      const auto &loop = static_cast<const statement::While &>(*node);
+      expr("condition", loop.condition.get());
+      stmt("body", loop.body.get());
+      break;
+    }
+    case kFor: {
+      const auto &loop = static_cast<const statement::For &>(*node);
+      stmt("initializer", loop.initializer.get());
+      expr("condition", loop.condition.get());
+      expr("increment", loop.increment.get());
+      stmt("body", loop.body.get());
+      break;
+    }
+    case kFunction: {
+      const auto &function = static_cast<const statement::Function &>(*node);
+      token("name", function.name);
+      emitter.field("parameters");
+      emitter.begin_list(function.parameters.size());
+      for (auto i = std::size_t{}; i < function.parameters.size(); ++i) {
+        emitter.item(i);
+        emitter.token(function.parameters[i]);
+      }
+      emitter.end_list();
+      // a body left for the first call is parsed now.
+      if (function.lazy_body)
+        if (auto res = function.lazy_body->parse(); !res && status.ok())
+          status = std::move(res);
+      stmts("body", function.statements());
+      break;
+    }
+    case kReturn:
+      expr("value", static_cast<const statement::Return &>(*node).value.get());
+      break;
+    }
+    emitter.end_node();
+  }
+  void stmt(const string_view_type name, const statement::Stmt *const node) {
+    emitter.field(name);
+    stmt(node);
+  }
+  void stmts(const string_view_type name,
+             const std::vector<ASTWriter::stmt_ptr_t> &nodes) {
+    emitter.field(name);
+    emitter.begin_list(nodes.size());
+    for (auto i = std::size_t{}; i < nodes.size(); ++i) {
+      emitter.item(i);
+      stmt(nodes[i].get());
+    }
+    emitter.end_list();
+  }
+  void expr(const expression::Expr *const node) {
+    if (!node)
+      return emitter.none();
+    emitter.begin_node(tag_of(node->kind));
+    using enum expression::Expr::Kind;
+    switch (node->kind) {
+    case kLiteral:
+      token("token", static_cast<const expression::Literal &>(*node).literal);
+      break;
+    case kUnary: {
+      const auto &unary = static_cast<const expression::Unary &>(*node);
+      token("operator", unary.op);
+      expr("operand", unary.expr.get());
+      break;
+    }
+    case kBinary: {
+      const auto &binary = static_cast<const expression::Binary &>(*node);
+      token("operator", binary.op);
+      expr("left", binary.left.get());
+      expr("right", binary.right.get());
+      break;
+    }
+    case kVariable:
+      token("name", static_cast<const expression::Variable &>(*node).name);
+      break;
+    case kGrouping:
+      expr("expression",
+           static_cast<const expression::Grouping &>(*node).expr.get());
+      break;
+    case kAssignment: {
+      const auto &assignment =
+          static_cast<const expression::Assignment &>(*node);
+      token("name", assignment.name);
+      expr("value", assignment.value_expr.get());
+      break;
+    }
+    case kLogical: {
+      const auto &logical = static_cast<const expression::Logical &>(*node);
+      token("operator", logical.op);
+      expr("left", logical.left.get());
+      expr("right", logical.right.get());
+      break;
+    }
+    case kCall: {
+      const auto &call = static_cast<const expression::Call &>(*node);
+      expr("callee", call.callee.get());
+      token("paren", call.paren);
+      emitter.field("arguments");
+      emitter.begin_list(call.args.size());
+      for (auto i = std::size_t{}; i < call.args.size(); ++i) {
+        emitter.item(i);
+        expr(call.args[i].get());
+      }
+      emitter.end_list();
+      break;
+    }
+    }
+    emitter.end_node();
+  }
+  void expr(const string_view_type name, const expression::Expr *const node) {
+    emitter.field(name);
+    expr(node);
+  }
+  void token(const string_view_type name, const Token &token) {
+    emitter.field(name);
+    emitter.token(token);
+  }
+
+private:
+  Emitter &emitter;
+  utils::Status status;
+};
+} // namespace
+
+ASTWriter::ASTWriter(const Format format) : my_format(format) {}
+
+auto ASTWriter::write(const std::span<const stmt_ptr_t> statements)
+    -> utils::Status {
+  const auto size = my_buffer.size();
+  auto res = utils::Status{};
+  if (my_format == Format::kBinary) {
+    auto emitter = BinaryEmitter{my_buffer};
+    res = Walker{emitter}.program(statements);
+  } else {
+    auto emitter = JsonEmitter{my_buffer};
+    res = Walker{emitter}.program(statements);
+  }
+  if (!res)
+    my_buffer.resize(size);
+  return res;
+}
+
+auto ASTWriter::take() noexcept -> string_type {
+  return std::exchange(my_buffer, {});
+}
+
+auto ASTWriter::name_of(const Tag tag) noexcept -> string_view_type {
+  switch (tag) {
+  case Tag::kNone:
+    return {};
+  case Tag::kLiteral:
+    return "Literal"sv;
+  case Tag::kUnary:
+    return "Unary"sv;
+  case Tag::kBinary:
+    return "Binary"sv;
+  case Tag::kVariable:
+    return "Variable"sv;
+  case Tag::kGrouping:
+    return "Grouping"sv;
+  case Tag::kAssignment:
+    return "Assignment"sv;
+  case Tag::kLogical:
+    return "Logical"sv;
+  case Tag::kCall:
+    return "Call"sv;
+  case Tag::kVar:
+    return "Var"sv;
+  case Tag::kPrint:
+    return "Print"sv;
+  case Tag::kExpression:
+    return "Expression"sv;
+  case Tag::kBlock:
+    return "Block"sv;
+  case Tag::kIf:
+    return "If"sv;
+  case Tag::kWhile:
+    return "While"sv;
+  case Tag::kFor:
+    return "For"sv;
+  case Tag::kFunction:
+    return "Function"sv;
+  case Tag::kReturn:
+    return "Return"sv;
+  }
+  return {};
+}
+} // namespace net::ancillarycat::loxo
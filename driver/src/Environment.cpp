@@ -2,7 +2,10 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <utility>
 
 #include <net/ancillarycat/utils/Status.hpp>
 
@@ -10,33 +13,73 @@
 #include "details/loxo_fwd.hpp"
 #include "Environment.hpp"
 #include "Evaluatable.hpp"
+#include "Stats.hpp"
 
 namespace net::ancillarycat::loxo {
+/// @brief a function frame and its slots, allocated in one go.
+struct Environment::Frame {
+  frame_slots_t slots;
+  Environment env;
+};
+
+void Upvalue::close() {
+  contract_assert(is_open())
+  my_closed = std::move(*my_location);
+  my_location = &my_closed;
+}
+
+Environment::Environment() { ++Stats::counters().environments; }
 
 Environment::Environment(const std::shared_ptr<self_type> &enclosing)
-    : parent(enclosing) {}
+    : parent(enclosing) {
+  ++Stats::counters().environments;
+}
+
+Environment::~Environment() { close_upvalues(); }
+
+void Environment::close_upvalues() {
+  for (const auto &upvalue : my_open_upvalues) {
+    upvalue->close();
+    // a local function that calls itself captures its own name: the closed
+    // upvalue would own the closure environment, which owns the upvalue.
+    const auto callable =
+        utils::get_if<evaluation::Callable>(std::addressof(upvalue->get()));
+    if (!callable || !callable->environment())
+      continue;
+    if (const auto &captured = callable->environment()->my_upvalues;
+        std::ranges::find(captured, upvalue) != captured.end())
+      callable->hold_environment_weakly();
+  }
+  my_open_upvalues.clear();
+}
 
 Environment::Environment(Environment &&that) noexcept {
   current = std::move(that.current);
   parent = std::move(that.parent);
+  my_slots = std::exchange(that.my_slots, nullptr);
+  my_slot_names = std::move(that.my_slot_names);
+  my_upvalues = std::move(that.my_upvalues);
+  my_upvalue_names = std::move(that.my_upvalue_names);
+  my_open_upvalues = std::move(that.my_open_upvalues);
 }
 
 auto Environment::operator=(Environment &&that) noexcept -> Environment & {
   if (this == &that) {
     return *this;
   }
+  close_upvalues();
   this->current = std::move(that.current);
   this->parent = std::move(that.parent);
+  this->my_slots = std::exchange(that.my_slots, nullptr);
+  this->my_slot_names = std::move(that.my_slot_names);
+  this->my_upvalues = std::move(that.my_upvalues);
+  this->my_upvalue_names = std::move(that.my_upvalue_names);
+  this->my_open_upvalues = std::move(that.my_open_upvalues);
   return *this;
 }
 
-auto Environment::getGlobalEnvironment()
-    -> utils::StatusOr<std::shared_ptr<Environment>> {
-  static auto has_init = false;
-  if (has_init)
-    return global_env;
-  has_init = true;
-  global_env = std::make_shared<Environment>();
+auto Environment::createGlobalEnvironment() -> std::shared_ptr<Environment> {
+  auto global_env = std::make_shared<Environment>();
   global_env
       ->add(
           "clock"s,
@@ -65,56 +108,249 @@ auto Environment::getGlobalEnvironment()
 
 auto Environment::createScopeEnvironment(
     const std::shared_ptr<self_type> &enclosing) -> std::shared_ptr<self_type> {
-  TODO()
+  const auto scope =
+      Stats::AllocationScope{Stats::AllocationKind::kEnvironment};
+  return std::make_shared<self_type>(enclosing);
+}
+
+auto Environment::createFrameEnvironment(
+    const std::shared_ptr<self_type> &enclosing, const slot_names_t &names)
+    -> std::shared_ptr<self_type> {
+  const auto scope =
+      Stats::AllocationScope{Stats::AllocationKind::kEnvironment};
+  auto frame = std::make_shared<Frame>();
+  frame->slots.reserve(names->size());
+  frame->env.parent = enclosing;
+  frame->env.my_slots = &frame->slots;
+  frame->env.my_slot_names = names;
+  // aliasing constructor: the environment keeps the whole frame alive.
+  return {frame, &frame->env};
+}
+
+auto Environment::createClosureEnvironment(
+    const std::shared_ptr<self_type> &enclosing, const slot_names_t &names)
+    -> std::shared_ptr<self_type> {
+  const auto scope =
+      Stats::AllocationScope{Stats::AllocationKind::kEnvironment};
+  auto upvalues = upvalues_t{};
+  upvalues.reserve(names->size());
+  auto captured_any = false;
+  for (const auto &name : *names) {
+    auto &upvalue = upvalues.emplace_back(enclosing->capture(name));
+    captured_any |= !!upvalue;
+  }
+  if (!captured_any)
+    return enclosing->root();
+
+  auto closure = std::make_shared<self_type>(enclosing->root());
+  closure->my_upvalues = std::move(upvalues);
+  closure->my_upvalue_names = names;
+  return closure;
 }
 
 auto Environment::add(const string_type &name,
                       const utils::IVisitor::variant_type &value,
                       const uint_least32_t line) const -> utils::Status {
+  const auto scope =
+      Stats::AllocationScope{Stats::AllocationKind::kEnvironment};
+  // redefining a parameter inside the function body rebinds the slot, just
+  // like redefining a variable in the same scope.
+  if (const auto slot = find_slot(name)) {
+    *slot = value;
+    return utils::OkStatus();
+  }
   return current.add(name, value, line);
 }
 
 auto Environment::reassign(const string_type &name,
                            const utils::IVisitor::variant_type &value,
-                           const uint_least32_t line) const -> utils::Status {
-  if (const auto it = find(name)) {
-    (*it)->second.first = value;
-    (*it)->second.second = line;
+                           const uint_least32_t) const -> utils::Status {
+  if (const auto ptr = find(name)) {
+    *ptr = value;
     return utils::OkStatus();
   }
   return utils::InvalidArgument("variable not defined");
 }
 
+void Environment::clear() const {
+  // a value destroyed here may look up this environment, so empty it first.
+  const auto bindings = std::exchange(current.associations, {});
+}
+
 auto Environment::get(const string_type &name) const
     -> utils::IVisitor::variant_type {
-  if (const auto it = find(name))
-    return {(*it)->second.first};
+  if (const auto ptr = find(name))
+    return {*ptr};
 
   return {utils::Monostate{}};
 }
 
+auto Environment::slots() const -> frame_slots_t & {
+  contract_assert(my_slots != nullptr, 1, "not a function frame")
+  return *my_slots;
+}
+
+auto Environment::find_upvalue(const string_type &name) const -> Upvalue * {
+  if (my_upvalues.empty())
+    return nullptr;
+  for (std::size_t i = 0; i < my_upvalues.size(); ++i)
+    if (my_upvalues[i] && (*my_upvalue_names)[i] == name)
+      return my_upvalues[i].get();
+  return nullptr;
+}
+
+auto Environment::find_local(const string_type &name) const
+    -> variant_type * {
+  if (const auto slot = find_slot(name))
+    return slot;
+  if (const auto it = current.find(name))
+    return std::addressof((*it)->second.first);
+  return nullptr;
+}
+
+auto Environment::capture(const string_type &name) const -> upvalue_ptr_t {
+  for (auto env = this; env && env->parent; env = env->parent.get()) {
+    if (const auto location = env->find_local(name)) {
+      // closures declared in the same scope share one upvalue per variable.
+      for (const auto &upvalue : env->my_open_upvalues)
+        if (upvalue->location() == location)
+          return upvalue;
+      return env->my_open_upvalues.emplace_back(
+          std::make_shared<Upvalue>(location));
+    }
+    for (std::size_t i = 0; i < env->my_upvalues.size(); ++i)
+      if (env->my_upvalues[i] && (*env->my_upvalue_names)[i] == name)
+        return env->my_upvalues[i];
+  }
+  // reached the global environment.
+  return nullptr;
+}
+
+auto Environment::find_here(const string_type &name) const
+    -> variant_type * {
+  if (const auto value = find_local(name))
+    return value;
+  if (const auto upvalue = find_upvalue(name))
+    return std::addressof(upvalue->get());
+  return nullptr;
+}
+
+auto Environment::find_here(LookupCache &cache) const -> variant_type * {
+  if (const auto value = find_local(cache.name)) {
+    cache.value = value;
+    cache.upvalue = nullptr;
+    return value;
+  }
+  if (const auto upvalue = find_upvalue(cache.name)) {
+    // the upvalue closes when the declaring frame goes, moving the value;
+    // only the upvalue itself stays put.
+    cache.value = nullptr;
+    cache.upvalue = upvalue;
+    return std::addressof(upvalue->get());
+  }
+  return nullptr;
+}
+
+auto Environment::binding_count() const noexcept -> std::uint32_t {
+  return static_cast<std::uint32_t>((my_slots ? my_slots->size() : 0) +
+                                    current.associations.size() +
+                                    my_upvalues.size());
+}
+
+auto Environment::find(LookupCache &cache) const -> variant_type * {
+  auto &counters = Stats::counters();
+  if (cache.is_valid()) {
+    auto env = this;
+    auto depth = std::uint32_t{0};
+    for (; env && depth < cache.depth; ++depth, env = env->parent.get())
+      if (env->binding_count() != cache.counts[depth])
+        break;
+
+    if (env && depth == cache.depth) {
+      if (env->my_serial == cache.serial) {
+        ++counters.lookup_hits;
+        return cache.get();
+      }
+      // same place, another instance (e.g. a new call frame): hash once.
+      if (const auto value = env->find_here(cache)) {
+        ++counters.lookup_hits;
+        cache.serial = env->my_serial;
+        return value;
+      }
+    }
+  }
+
+  ++counters.lookup_misses;
+  cache.invalidate();
+  auto depth = std::uint32_t{0};
+  for (auto env = this; env; ++depth, env = env->parent.get()) {
+    if (depth >= LookupCache::kMaxDepth) {
+      if (const auto value = env->find_here(cache.name))
+        return value;
+    } else if (const auto value = env->find_here(cache)) {
+      cache.depth = depth;
+      cache.serial = env->my_serial;
+      return value;
+    }
+    if (depth < LookupCache::kMaxDepth)
+      cache.counts[depth] = env->binding_count();
+  }
+  return nullptr;
+}
+
+auto Environment::next_serial() noexcept -> std::uint64_t {
+  static constinit auto serial = std::atomic_uint64_t{0};
+  return serial.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+auto LookupCache::get() const noexcept -> variant_type * {
+  return upvalue ? std::addressof(upvalue->get()) : value;
+}
+
+auto Environment::root() const -> std::shared_ptr<self_type> {
+  auto env = this;
+  while (env->parent)
+    env = env->parent.get();
+  return std::const_pointer_cast<self_type>(env->shared_from_this());
+}
+
+auto Environment::find_slot(const string_type &name) const -> variant_type * {
+  if (!my_slots)
+    return nullptr;
+  // parameters are few; a linear scan beats hashing the name.
+  for (std::size_t i = 0; i < my_slots->size(); ++i)
+    if ((*my_slot_names)[i] == name)
+      return std::addressof((*my_slots)[i]);
+  return nullptr;
+}
+
 // NOLINTNEXTLINE
-auto Environment::find(const string_type &name) const
-    -> std::optional<self_type::scope_env_t::associations_t::iterator> {
+auto Environment::find(const string_type &name) const -> variant_type * {
+  if (const auto slot = find_slot(name))
+    return slot;
+
   if (auto maybe_it = current.find(name)) {
     // NOLINTNEXTLINE
     dbg_block(
         if (!parent) {
           return nullptr;
-        } if (const auto another_it = parent->find(name)) {
+        } if (parent->find(name)) {
           dbg(warn,
-              "variable '{}' is shadowed; previously declared at line {}",
+              "variable '{}' declared at line {} shadows an outer one",
               name,
-              (*another_it)->second.second);
+              (*maybe_it)->second.second);
         })
-    return maybe_it;
+    return std::addressof((*maybe_it)->second.first);
   }
 
+  if (const auto upvalue = find_upvalue(name))
+    return std::addressof(upvalue->get());
+
   if (const auto enclosing = parent.get()) {
     return enclosing->find(name);
   }
 
-  return std::nullopt;
+  return nullptr;
 }
 
 auto Environment::copy() const -> std::shared_ptr<self_type> {
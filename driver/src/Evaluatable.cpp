@@ -3,14 +3,25 @@
 #include <net/ancillarycat/utils/Monostate.hpp>
 #include <net/ancillarycat/utils/Status.hpp>
 #include <net/ancillarycat/utils/config.hpp>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "details/loxo_fwd.hpp"
 
 #include "Evaluatable.hpp"
 #include "Environment.hpp"
 #include "interpreter.hpp"
+#include "Instrumentation.hpp"
+#include "Profiler.hpp"
+#include "Stats.hpp"
+#include "statement.hpp"
+#include "Tracer.hpp"
 
 namespace net::ancillarycat::loxo::evaluation {
 using utils::match;
@@ -100,14 +111,166 @@ auto Nil::to_string_view_impl(const utils::FormatPolicy &format_policy) const
   return "nil"sv;
 }
 
+/// @brief either a flat buffer or the concatenation of two ropes, which is
+/// flattened the first time its characters are needed (printing, comparing,
+/// hashing) and then keeps the flat buffer for every other copy.
+/// @note `s = s + piece;` in a loop builds a left-leaning tree as deep as the
+/// loop is long, so both flattening and destruction are iterative.
+struct String::Rope {
+  using string_ptr_t = std::shared_ptr<const string_type>;
+  using rope_ptr_t = std::shared_ptr<const Rope>;
+
+  explicit Rope(string_ptr_t flat) noexcept
+      : flat(std::move(flat)), length(this->flat->size()) {}
+  Rope(rope_ptr_t left, rope_ptr_t right) noexcept
+      : left(std::move(left)), right(std::move(right)),
+        length(this->left->length + this->right->length) {}
+  Rope(const Rope &) = delete;
+  auto operator=(const Rope &) = delete;
+  ~Rope() { release(); }
+
+  auto str() const -> const string_type & {
+    if (!flat)
+      flatten();
+    return *flat;
+  }
+
+  auto hash() const -> std::size_t {
+    if (!has_hash) {
+      hash_value = std::hash<string_type>{}(str());
+      has_hash = true;
+    }
+    return hash_value;
+  }
+
+  mutable string_ptr_t flat;
+  mutable rope_ptr_t left;
+  mutable rope_ptr_t right;
+  const std::size_t length = 0;
+  mutable std::size_t hash_value = 0;
+  mutable bool has_hash = false;
+  /// @brief set only for the canonical node in the intern table, so two
+  /// different interned nodes never have equal contents.
+  bool interned = false;
+
+private:
+  void flatten() const {
+    const auto scope = Stats::AllocationScope{Stats::AllocationKind::kString};
+    auto result = string_type{};
+    result.reserve(length);
+    auto pending = std::vector<const Rope *>{this};
+    while (!pending.empty()) {
+      const auto node = pending.back();
+      pending.pop_back();
+      if (node->flat) {
+        result += *node->flat;
+        continue;
+      }
+      pending.push_back(node->right.get());
+      pending.push_back(node->left.get());
+    }
+    flat = std::make_shared<const string_type>(std::move(result));
+    release();
+  }
+  /// @brief drop the children without recursing through a deep tree.
+  void release() const noexcept {
+    auto orphans = std::vector<rope_ptr_t>{};
+    const auto adopt = [&](rope_ptr_t &child) {
+      if (child)
+        orphans.emplace_back(std::move(child));
+    };
+    adopt(left);
+    adopt(right);
+    while (!orphans.empty()) {
+      auto node = std::move(orphans.back());
+      orphans.pop_back();
+      // only take the grandchildren if we are the last owner, otherwise they
+      // are still reachable from somewhere else.
+      if (node.use_count() == 1) {
+        adopt(node->left);
+        adopt(node->right);
+      }
+    }
+  }
+};
+
+template <typename Value>
+auto String::make_flat(Value &&value) -> std::shared_ptr<const Rope> {
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kString};
+  if constexpr (std::is_same_v<std::remove_cvref_t<Value>,
+                               std::shared_ptr<const string_type>>)
+    return std::make_shared<const Rope>(std::forward<Value>(value));
+  else
+    return std::make_shared<const Rope>(
+        std::make_shared<const string_type>(std::forward<Value>(value)));
+}
+
 String::String(const string_type &value, const uint_least32_t line)
-    : Evaluatable(line), value(value) {}
+    : Evaluatable(line), value(make_flat(value)) {}
 
 String::String(const string_view_type value, const uint_least32_t line)
-    : Evaluatable(line), value(value) {}
+    : Evaluatable(line), value(make_flat(value)) {}
 
 String::String(string_type &&value, const uint_least32_t line) noexcept
-    : Evaluatable(line), value(std::move(value)) {}
+    : Evaluatable(line), value(make_flat(std::move(value))) {}
+
+String::String(std::shared_ptr<const string_type> value,
+               const uint_least32_t line) noexcept
+    : Evaluatable(line), value(make_flat(std::move(value))) {}
+
+namespace {
+/// @brief the canonical node of every interned string still in use. The
+/// entries are weak and a node removes its own when it dies, so the table
+/// only holds what some AST or value still refers to: a REPL forgets the
+/// literals of the declarations it is done with, and `serve` those of the
+/// programs it has evicted.
+/// @note only parsing interns, so the lock is never taken while running.
+template <typename Rope> struct InternTable {
+  std::mutex mutex;
+  // keys view the flat buffer of the node they map to.
+  std::unordered_map<std::string_view, std::weak_ptr<const Rope>> entries;
+
+  /// @brief never destroyed, as interned nodes may outlive static storage.
+  static auto instance() -> InternTable & {
+    static auto &table = *new InternTable{};
+    return table;
+  }
+};
+} // namespace
+
+auto String::intern(const string_view_type value, const uint_least32_t line)
+    -> String {
+  auto &table = InternTable<Rope>::instance();
+  const auto lock = std::scoped_lock{table.mutex};
+  if (const auto it = table.entries.find(value); it != table.entries.end()) {
+    if (auto rope = it->second.lock())
+      return {std::move(rope), line};
+    // dying on another thread; its key views the buffer it is about to free.
+    table.entries.erase(it);
+  }
+
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kString};
+  auto rope = std::shared_ptr<Rope>(
+      new Rope(std::make_shared<const string_type>(value)), [](Rope *node) {
+        auto &table = InternTable<Rope>::instance();
+        {
+          const auto lock = std::scoped_lock{table.mutex};
+          // unless a new node took the place of this one already.
+          if (const auto it = table.entries.find(*node->flat);
+              it != table.entries.end() && it->second.expired())
+            table.entries.erase(it);
+        }
+        delete node;
+      });
+  rope->interned = true;
+  rope->hash();
+  table.entries.emplace(string_view_type{*rope->flat}, rope);
+  return {std::move(rope), line};
+}
+
+String::String(std::shared_ptr<const Rope> rope,
+               const uint_least32_t line) noexcept
+    : Evaluatable(line), value(std::move(rope)) {}
 
 String::String(const String &that)
     : Evaluatable(that.get_line()), utils::Viewable(), value(that.value) {}
@@ -133,148 +296,251 @@ String &String::operator=(String &&that) noexcept {
 }
 
 String String::operator+(const String &rhs) const {
-  return String{value + rhs.value};
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kString};
+  if (size() + rhs.size() <= kFlatConcatLimit)
+    return String{str() + rhs.str()};
+  if (rhs.size() == 0)
+    return *this;
+  if (size() == 0)
+    return rhs;
+  return {std::make_shared<const Rope>(value, rhs.value), get_line()};
 }
 
 Boolean String::operator==(const String &rhs) const {
-  return {value == rhs.value};
+  if (value == rhs.value)
+    return {true};
+  if (!value || !rhs.value)
+    return {size() == rhs.size()};
+  if (value->interned && rhs.value->interned)
+    return {false};
+  if (size() != rhs.size())
+    return {false};
+  if (value->has_hash && rhs.value->has_hash &&
+      value->hash_value != rhs.value->hash_value)
+    return {false};
+  return {str() == rhs.str()};
 }
 
 Boolean String::operator!=(const String &rhs) const {
-  return {value != rhs.value};
+  return {!(*this == rhs).is_true()};
 }
 
 String::operator Boolean() const { return True; }
 
 auto String::to_string_impl(const utils::FormatPolicy &format_policy) const
     -> string_type {
-  return value;
+  return str();
 }
 
 auto String::to_string_view_impl(const utils::FormatPolicy &format_policy) const
     -> string_view_type {
-  return value;
+  return str();
+}
+
+auto String::str() const -> const string_type & {
+  static const auto empty = string_type{};
+  return value ? value->str() : empty;
+}
+
+auto String::hash() const -> std::size_t {
+  return value ? value->hash() : std::hash<string_type>{}(string_type{});
+}
+
+auto String::size() const noexcept -> std::size_t {
+  return value ? value->length : 0;
 }
 
 Number::Number(const long double value, const uint_least32_t line)
-    : Value(line), value(value) {}
+    : Value(line) {
+  // keep -0 (and of course NaN/inf) as they are, so they print the same.
+  if (std::fabs(value) <= static_cast<long double>(kMaxInteger) &&
+      std::trunc(value) == value && !(value == 0 && std::signbit(value))) {
+    integer = static_cast<std::int64_t>(value);
+    my_is_integer = true;
+  } else {
+    this->value = value;
+  }
+}
 
 Number::Number(const Number &that)
-    : Value(that.get_line()), value(that.value) {}
+    : Value(that.get_line()), my_is_integer(that.my_is_integer) {
+  if (my_is_integer)
+    integer = that.integer;
+  else
+    value = that.value;
+}
 
-Number::Number(Number &&that) noexcept
-    : Value(that.get_line()), value(that.value) {}
+Number::Number(Number &&that) noexcept : Number(std::as_const(that)) {}
 
 Number &Number::operator=(const Number &that) {
   if (this == &that)
     return *this;
-  value = that.value;
+  my_is_integer = that.my_is_integer;
+  if (my_is_integer)
+    integer = that.integer;
+  else
+    value = that.value;
   Evaluatable::operator=(that);
   return *this;
 }
 
 Number &Number::operator=(Number &&that) noexcept {
-  if (this == &that)
-    return *this;
-  value = that.value;
-  Evaluatable::operator=(that);
-  return *this;
+  return *this = std::as_const(that);
+}
+
+auto Number::from_integer(const std::int64_t integer) noexcept -> Number {
+  if (integer > kMaxInteger || integer < -kMaxInteger)
+    return from_real(static_cast<long double>(integer));
+  auto result = Number{};
+  result.integer = integer;
+  result.my_is_integer = true;
+  return result;
+}
+
+auto Number::from_real(const long double value) noexcept -> Number {
+  auto result = Number{};
+  result.value = value;
+  return result;
 }
 
 Boolean Number::operator==(const Number &that) const {
-  return {value == that.value};
+  if (my_is_integer && that.my_is_integer)
+    return {integer == that.integer};
+  return {as_real() == that.as_real()};
 }
 
 Boolean Number::operator!=(const Number &that) const {
-  return {value != that.value};
+  return {!(*this == that).is_true()};
 }
 
 Boolean Number::operator<(const Number &that) const {
-  return {value < that.value};
+  if (my_is_integer && that.my_is_integer)
+    return {integer < that.integer};
+  return {as_real() < that.as_real()};
 }
 
 Boolean Number::operator<=(const Number &that) const {
-  return {value <= that.value};
+  if (my_is_integer && that.my_is_integer)
+    return {integer <= that.integer};
+  return {as_real() <= that.as_real()};
 }
 
 Boolean Number::operator>(const Number &that) const {
-  return {value > that.value};
+  if (my_is_integer && that.my_is_integer)
+    return {integer > that.integer};
+  return {as_real() > that.as_real()};
 }
 
 Boolean Number::operator>=(const Number &that) const {
-  return {value >= that.value};
+  if (my_is_integer && that.my_is_integer)
+    return {integer >= that.integer};
+  return {as_real() >= that.as_real()};
 }
 
+// both operands are within +-2^53, so sums and differences cannot overflow;
+// `from_integer` promotes results that left the exact range.
 Number Number::operator-(const Number &that) const {
-  return {value - that.value};
+  if (my_is_integer && that.my_is_integer)
+    return from_integer(integer - that.integer);
+  return {as_real() - that.as_real()};
 }
 
 Number Number::operator+(const Number &that) const {
-  return {value + that.value};
+  if (my_is_integer && that.my_is_integer)
+    return from_integer(integer + that.integer);
+  return {as_real() + that.as_real()};
 }
 
 Number Number::operator*(const Number &that) const {
-  return {value * that.value};
+  if (my_is_integer && that.my_is_integer) {
+    const auto lhs = integer, rhs = that.integer;
+    // zero times a negative number is -0 in floating point.
+    const auto negative_zero = (lhs == 0 && rhs < 0) || (rhs == 0 && lhs < 0);
+    const auto fits = lhs == 0 || (rhs < 0 ? -rhs : rhs) <=
+                                      kMaxInteger / (lhs < 0 ? -lhs : lhs);
+    if (fits && !negative_zero)
+      return from_integer(lhs * rhs);
+  }
+  return {as_real() * that.as_real()};
 }
 
 Number Number::operator/(const Number &that) const {
-  return that.value == 0L
-             ? Number{std::numeric_limits<long double>::signaling_NaN()}
-             : Number{value / that.value};
+  if (that.as_real() == 0)
+    return Number{std::numeric_limits<long double>::signaling_NaN()};
+  if (my_is_integer && that.my_is_integer && integer % that.integer == 0 &&
+      !(integer == 0 && that.integer < 0))
+    return from_integer(integer / that.integer);
+  return {as_real() / that.as_real()};
 }
 
 Number &Number::operator+=(const Number &that) {
-  value += that.value;
-  return *this;
+  return *this = *this + that;
 }
 
 Number &Number::operator-=(const Number &that) {
-  value -= that.value;
-  return *this;
+  return *this = *this - that;
 }
 
 Number &Number::operator*=(const Number &that) {
-  value *= that.value;
-  return *this;
+  return *this = *this * that;
 }
 
 Number &Number::operator/=(const Number &that) {
-  value = that.value == 0L ? std::numeric_limits<long double>::signaling_NaN()
-                           : value / that.value;
-  return *this;
+  return *this = *this / that;
 }
 
 auto Number::to_string_impl(const utils::FormatPolicy &format_policy) const
     -> string_type {
-  return utils::format("{}", value);
+  char buffer[utils::kMaxNumberChars];
+  const auto end =
+      my_is_integer
+          ? utils::number_to_chars(buffer, buffer + sizeof buffer, integer)
+          : utils::number_to_chars(buffer, buffer + sizeof buffer, value);
+  return {buffer, end};
 }
 
-Callable::Callable(unsigned argc,
-                   native_function_t &&func,
-                   const env_ptr_t &env) {
-  my_arity = argc;
-  my_function.emplace(std::move(func));
-  my_env = env;
-}
+Callable::Callable(prototype_ptr_t &&prototype, const env_ptr_t &env)
+    : my_prototype(std::move(prototype)), my_env(env) {}
+
+Callable::Callable(const Callable &that)
+    : Evaluatable(that), my_prototype(that.my_prototype),
+      my_env(that.environment()) {}
 
-Callable::Callable(unsigned argc,
-                   custom_function_t &&block,
-                   const env_ptr_t &env) {
-  my_arity = argc;
-  my_function.emplace(std::move(block));
-  my_env = env;
+auto Callable::operator=(const Callable &that) -> Callable & {
+  if (this == &that)
+    return *this;
+  Evaluatable::operator=(that);
+  my_prototype = that.my_prototype;
+  my_env = that.environment();
+  my_weak_env.reset();
+  return *this;
 }
 
-auto Callable::create_custom(unsigned argc,
-                             custom_function_t &&func,
+auto Callable::create_custom(const prototype_ptr_t &prototype,
                              const env_ptr_t &env) -> Callable {
-  return {argc, std::move(func), env};
+  contract_assert(prototype && !prototype->native)
+  return {prototype_ptr_t{prototype}, env};
 }
 
 auto Callable::create_native(unsigned argc,
                              native_function_t &&func,
                              const env_ptr_t &env) -> Callable {
-  return {argc, std::move(func), env};
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kCallable};
+  auto prototype = std::make_shared<prototype_t>();
+  prototype->name = native_signature;
+  prototype->arity = argc;
+  prototype->native = std::move(func);
+  return {std::move(prototype), env};
+}
+
+auto Callable::is_native() const noexcept -> bool {
+  return my_prototype && my_prototype->native;
+}
+
+auto Callable::make_frame() const -> env_ptr_t {
+  contract_assert(!is_native(), 1, "native functions have no frame")
+  return Environment::createFrameEnvironment(environment(),
+                                             my_prototype->parameters);
 }
 
 auto Callable::call(const interpreter &interpreter, args_t &&args) const
@@ -282,63 +548,70 @@ auto Callable::call(const interpreter &interpreter, args_t &&args) const
   contract_assert(this->arity() == args.size(),
                   1,
                   "arity mismatch; should check it before calling")
-  return my_function.visit(
-      match{[&](const native_function_t &native_function) -> eval_result_t {
-              return {native_function.operator()(interpreter, args)};
-            },
-            [&](const custom_function_t &custom_function) -> eval_result_t {
-              auto saved_env = interpreter.get_current_env();
-
-              auto scoped_env = std::make_shared<Environment>(this->my_env);
-
-              for (size_t i = 0; i < custom_function.parameters.size(); ++i) {
-                if (auto res =
-                        scoped_env->add(custom_function.parameters[i], args[i]);
-                    !res.ok()) {
-                  return res;
-                }
-              }
-
-              dbg(info, "entering a function...")
-              interpreter.set_env(scoped_env);
-
-              for (const auto &index : custom_function.body) {
-                auto res = interpreter.execute(*index);
-                if (!res) {
-                  if (res.code() == utils::Status::kReturning) {
-                    auto my_result = interpreter.get_result();
-                    // FIXME: i my logic was completely gone here: `last_expr`
-                    //              itself was a mistake!
-                    dbg(info, "returning: {}", my_result->underlying_string())
-                    dbg(info,
-                        "current interpreter's returned res: {}",
-                        res->underlying_string())
-
-                    interpreter.set_env(saved_env);
-                    return my_result;
-                  }
-                  interpreter.set_env(saved_env);
-                  // else, error, return as is
-                  return res;
-                }
-              }
-              dbg(info, "void function, returning nil.")
-              return {NilValue};
-            },
-            [](const auto &) -> eval_result_t {
-              contract_assert(false, 1, "should not happen")
-              return {utils::NotFoundError("no function to call")};
-            }});
+  if (is_native()) {
+    ++Stats::counters().calls;
+    return {my_prototype->native(interpreter, args)};
+  }
+
+  auto frame = make_frame();
+  for (auto &arg : args)
+    frame->slots().emplace_back(std::move(arg));
+  return call(interpreter, std::move(frame));
+}
+
+auto Callable::call(const interpreter &interpreter, env_ptr_t &&frame) const
+    -> eval_result_t {
+  contract_assert(this->arity() == frame->slots().size(),
+                  1,
+                  "arity mismatch; should check it before calling")
+  contract_assert(my_prototype && !is_native(), 1, "should not happen")
+  ++Stats::counters().calls;
+  const auto profiler_scope = Profiler::Scope{*my_prototype};
+  const auto trace_span = Tracer::Span{my_prototype->name, my_prototype->line};
+  const auto instrumentation_scope = Instrumentation::FunctionScope{
+      interpreter.get_instrumentation(), *my_prototype};
+  if (my_prototype->lazy_body)
+    if (auto res = my_prototype->lazy_body->parse(); !res)
+      return {res};
+  const auto &body = my_prototype->lazy_body
+                         ? my_prototype->lazy_body->statements()
+                         : my_prototype->body;
+  auto saved_env = interpreter.get_current_env();
+
+  dbg(info, "entering a function...")
+  interpreter.set_env(frame);
+
+  for (const auto &index : body) {
+    auto res = interpreter.execute(*index);
+    if (!res) {
+      if (res.code() == utils::Status::kReturning) {
+        auto my_result = interpreter.get_result();
+        // FIXME: i my logic was completely gone here: `last_expr`
+        //              itself was a mistake!
+        dbg(info, "returning: {}", my_result->underlying_string())
+        dbg(info,
+            "current interpreter's returned res: {}",
+            res->underlying_string())
+
+        interpreter.set_env(saved_env);
+        return my_result;
+      }
+      interpreter.set_env(saved_env);
+      // else, error, return as is
+      return res;
+    }
+  }
+  dbg(info, "void function, returning nil.")
+  interpreter.set_env(saved_env);
+  return {NilValue};
 }
 
 auto Callable::to_string_impl(const utils::FormatPolicy &) const
     -> string_type {
-  return my_function.visit(match{
-      [](const native_function_t &) { return "<native fn>"s; },
-      [](const custom_function_t &f) {
-        return utils::format("<fn {}>", f.name);
-      },
-      [](const auto &) { return "<unknown fn>"s; },
-  });
+  if (!my_prototype)
+    return "<unknown fn>"s;
+  if (is_native())
+    return string_type{native_signature};
+  return utils::format("<fn {}>", my_prototype->name);
 }
 } // namespace net::ancillarycat::loxo::evaluation
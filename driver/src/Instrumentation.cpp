@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <ranges>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/format.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+#include "Evaluatable.hpp"
+#include "Instrumentation.hpp"
+
+namespace net::ancillarycat::loxo {
+namespace {
+template <typename Key>
+void enter(Instrumentation::Table<Key> &table, const Key &key) {
+  auto &counters = table.counters[key];
+  ++counters.executions;
+  ++counters.active;
+  table.stack.push_back({&counters, Instrumentation::clock_t::now()});
+}
+template <typename Key> void leave(Instrumentation::Table<Key> &table) {
+  contract_assert(!table.stack.empty(), 1, "unbalanced enter/leave")
+  const auto activation = table.stack.back();
+  table.stack.pop_back();
+  const auto inclusive =
+      Instrumentation::clock_t::now() - activation.start;
+  activation.counters->exclusive += inclusive - activation.children;
+  if (--activation.counters->active == 0)
+    activation.counters->inclusive += inclusive;
+  if (!table.stack.empty())
+    table.stack.back().children += inclusive;
+}
+auto to_ms(const Instrumentation::duration_t duration) -> double {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+/// @brief hottest first; ties broken by @p key so that the report is stable.
+template <typename Entry, typename Key>
+void sort_by_exclusive(std::vector<Entry> &entries, Key &&key) {
+  std::ranges::sort(entries, [&](const auto &lhs, const auto &rhs) {
+    if (lhs.second.exclusive != rhs.second.exclusive)
+      return lhs.second.exclusive > rhs.second.exclusive;
+    return key(lhs) < key(rhs);
+  });
+}
+} // namespace
+
+void Instrumentation::enter_function(const prototype_t &prototype) {
+  enter(my_functions, &prototype);
+}
+void Instrumentation::leave_function() { leave(my_functions); }
+void Instrumentation::enter_line(const line_t line) { enter(my_lines, line); }
+void Instrumentation::leave_line() { leave(my_lines); }
+
+auto Instrumentation::to_string_impl(const utils::FormatPolicy &) const
+    -> string_type {
+  auto functions = std::vector<std::pair<const prototype_t *, Counters>>(
+      my_functions.counters.begin(), my_functions.counters.end());
+  sort_by_exclusive(functions, [](const auto &entry) {
+    return std::pair{entry.first->line, entry.first->name};
+  });
+  auto lines = std::vector<std::pair<line_t, Counters>>(
+      my_lines.counters.begin(), my_lines.counters.end());
+  sort_by_exclusive(lines, [](const auto &entry) { return entry.first; });
+
+  auto result = utils::format("{:<24}{:>8}{:>12}{:>14}{:>14}\n",
+                              "function",
+                              "line",
+                              "calls",
+                              "incl(ms)",
+                              "excl(ms)");
+  for (const auto &[prototype, counters] : functions)
+    result += utils::format("{:<24}{:>8}{:>12}{:>14.3f}{:>14.3f}\n",
+                            prototype->name,
+                            prototype->line,
+                            counters.executions,
+                            to_ms(counters.inclusive),
+                            to_ms(counters.exclusive));
+  result += utils::format("\n{:<32}{:>12}{:>14}{:>14}\n",
+                          "line",
+                          "executions",
+                          "incl(ms)",
+                          "excl(ms)");
+  for (const auto &[line, counters] : lines)
+    result += utils::format("{:<32}{:>12}{:>14.3f}{:>14.3f}\n",
+                            line,
+                            counters.executions,
+                            to_ms(counters.inclusive),
+                            to_ms(counters.exclusive));
+  return result;
+}
+} // namespace net::ancillarycat::loxo
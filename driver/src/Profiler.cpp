@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+#include "Evaluatable.hpp"
+#include "Profiler.hpp"
+
+namespace net::ancillarycat::loxo {
+Profiler::Profiler(const interval_type interval) : my_interval(interval) {}
+
+Profiler::~Profiler() { stop(); }
+
+auto Profiler::start() -> utils::Status {
+  if (auto expected = static_cast<Profiler *>(nullptr);
+      !active.compare_exchange_strong(expected, this))
+    return utils::AlreadyExistsError("another profiler is already running");
+  my_owner = std::this_thread::get_id();
+  my_stop.store(false, std::memory_order_relaxed);
+  my_sampler = std::thread([this] { run(); });
+  return utils::OkStatus();
+}
+
+void Profiler::stop() {
+  if (!my_sampler.joinable())
+    return;
+  // frames already pushed still pop themselves through their `Scope`.
+  active.store(nullptr, std::memory_order_relaxed);
+  my_stop.store(true, std::memory_order_relaxed);
+  my_sampler.join();
+}
+
+auto Profiler::enter(const prototype_t &prototype) noexcept -> Profiler * {
+  if (std::this_thread::get_id() != my_owner)
+    return nullptr;
+  const auto depth = my_depth.load(std::memory_order_relaxed);
+  my_generation.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (depth < kMaxDepth)
+    my_frames[depth].store(&prototype, std::memory_order_relaxed);
+  my_depth.store(depth + 1, std::memory_order_relaxed);
+  my_generation.fetch_add(1, std::memory_order_release);
+  return this;
+}
+
+void Profiler::leave() noexcept {
+  my_generation.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  my_depth.fetch_sub(1, std::memory_order_relaxed);
+  my_generation.fetch_add(1, std::memory_order_release);
+}
+
+void Profiler::run() {
+  auto next = std::chrono::steady_clock::now();
+  while (!my_stop.load(std::memory_order_relaxed)) {
+    next += my_interval;
+    std::this_thread::sleep_until(next);
+    sample();
+  }
+}
+
+void Profiler::sample() {
+  auto frames = std::array<const prototype_t *, kMaxDepth>{};
+  auto depth = std::size_t{};
+  // an odd generation means a push or pop is in progress; retry a few times
+  // and drop the sample if the stack keeps changing under us.
+  for (auto attempt = 0; attempt < 4; ++attempt) {
+    const auto before = my_generation.load(std::memory_order_acquire);
+    if (before & 1)
+      continue;
+    depth = std::min(my_depth.load(std::memory_order_relaxed), kMaxDepth);
+    for (auto i = std::size_t{}; i < depth; ++i)
+      frames[i] = my_frames[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (my_generation.load(std::memory_order_relaxed) != before)
+      continue;
+
+    auto stack = string_type{"<script>"};
+    for (auto i = std::size_t{}; i < depth; ++i) {
+      stack += ';';
+      stack += frames[i]->name;
+      stack += ':';
+      stack += std::to_string(frames[i]->line);
+    }
+    ++my_stacks[std::move(stack)];
+    ++my_sample_count;
+    return;
+  }
+  dbg(trace, "dropped a torn sample")
+}
+
+auto Profiler::folded() const -> string_type {
+  contract_assert(!my_sampler.joinable(), 1, "stop the profiler first")
+  auto result = string_type{};
+  for (const auto &[stack, count] : my_stacks) {
+    result += stack;
+    result += ' ';
+    result += std::to_string(count);
+    result += '\n';
+  }
+  return result;
+}
+
+auto Profiler::write(const path_type &path) const -> utils::Status {
+  auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+    return utils::PermissionDeniedError("cannot open profile output file");
+  file << folded();
+  return utils::OkStatus();
+}
+} // namespace net::ancillarycat::loxo
@@ -1,5 +1,181 @@
+#include <algorithm>
+#include <memory>
+#include <ranges>
+#include <utility>
+
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
 #include "Resolver.hpp"
-// TODO: Implement the Resolver class
+#include "expression.hpp"
+#include "statement.hpp"
+
 namespace net::ancillarycat::loxo {
-Resolver::Resolver(loxo::interpreter &interpreter) : interpreter(interpreter) {}
+auto Resolver::free_variables(const statement::Function &function) const
+    -> names_t {
+  scopes.clear();
+  free.clear();
+  // parameters and the locals of the body live in the same frame.
+  auto &frame = scopes.emplace_back();
+  for (const auto &param : function.parameters)
+    frame.emplace(param.to_string(utils::kTokenOnly));
+
+  if (function.lazy_body && !function.lazy_body->is_parsed()) {
+    // no tree to walk yet: every name the body mentions may be free. The
+    // frame finds its own variables first, so capturing one that is not free
+    // only keeps it alive for longer.
+    for (const auto &name : function.lazy_body->identifiers())
+      reference(name);
+  } else if (const auto res = resolve(function.statements()); !res) {
+    dbg(error, "failed to resolve function: {}", res.message())
+  }
+
+  scopes.clear();
+  return std::exchange(free, {});
+}
+void Resolver::declare(const string_type &name) const {
+  contract_assert(!scopes.empty())
+  scopes.back().emplace(name);
+}
+void Resolver::reference(const string_type &name) const {
+  if (std::ranges::any_of(scopes | std::views::reverse,
+                          [&](const auto &scope) { return scope.contains(name); }))
+    return;
+  if (std::ranges::find(free, name) == free.end())
+    free.emplace_back(name);
+}
+auto Resolver::resolve(const std::vector<std::shared_ptr<statement::Stmt>>
+                           &statements) const -> eval_result_t {
+  for (const auto &stmt : statements)
+    if (auto res = execute(*stmt); !res)
+      return res;
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const expression::Literal &) const -> eval_result_t {
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const expression::Unary &expr) const
+    -> eval_result_t {
+  return evaluate(*expr.expr);
+}
+auto Resolver::visit_impl(const expression::Binary &expr) const
+    -> eval_result_t {
+  if (auto res = evaluate(*expr.left); !res)
+    return res;
+  return evaluate(*expr.right);
+}
+auto Resolver::visit_impl(const expression::Grouping &expr) const
+    -> eval_result_t {
+  return evaluate(*expr.expr);
+}
+auto Resolver::visit_impl(const expression::Variable &expr) const
+    -> eval_result_t {
+  reference(expr.name.to_string(utils::kTokenOnly));
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const expression::Assignment &expr) const
+    -> eval_result_t {
+  if (auto res = evaluate(*expr.value_expr); !res)
+    return res;
+  reference(expr.name.to_string(utils::kTokenOnly));
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const expression::Logical &expr) const
+    -> eval_result_t {
+  if (auto res = evaluate(*expr.left); !res)
+    return res;
+  return evaluate(*expr.right);
+}
+auto Resolver::visit_impl(const expression::Call &expr) const
+    -> eval_result_t {
+  if (auto res = evaluate(*expr.callee); !res)
+    return res;
+  for (const auto &arg : expr.args)
+    if (auto res = evaluate(*arg); !res)
+      return res;
+  return utils::OkStatus();
+}
+auto Resolver::evaluate_impl(const expression::Expr &expr) const
+    -> eval_result_t {
+  return expr.accept(*this);
+}
+auto Resolver::get_result_impl() const -> eval_result_t {
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const statement::Variable &stmt) const
+    -> eval_result_t {
+  // the initializer is evaluated before the variable comes into scope.
+  if (stmt.has_initilizer())
+    if (auto res = evaluate(*stmt.initializer); !res)
+      return res;
+  declare(stmt.name.to_string(utils::kTokenOnly));
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const statement::Print &stmt) const
+    -> eval_result_t {
+  return evaluate(*stmt.value);
+}
+auto Resolver::visit_impl(const statement::Expression &stmt) const
+    -> eval_result_t {
+  return evaluate(*stmt.expr);
+}
+auto Resolver::visit_impl(const statement::Block &stmt) const
+    -> eval_result_t {
+  scopes.emplace_back();
+  auto res = resolve(stmt.statements);
+  scopes.pop_back();
+  return res;
+}
+auto Resolver::visit_impl(const statement::If &stmt) const -> eval_result_t {
+  if (auto res = evaluate(*stmt.condition); !res)
+    return res;
+  if (auto res = execute(*stmt.then_branch); !res)
+    return res;
+  if (stmt.else_branch)
+    return execute(*stmt.else_branch);
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const statement::While &stmt) const
+    -> eval_result_t {
+  if (auto res = evaluate(*stmt.condition); !res)
+    return res;
+  return execute(*stmt.body);
+}
+auto Resolver::visit_impl(const statement::For &stmt) const -> eval_result_t {
+  // the interpreter runs the initializer in the enclosing scope.
+  if (stmt.initializer)
+    if (auto res = execute(*stmt.initializer); !res)
+      return res;
+  if (stmt.condition)
+    if (auto res = evaluate(*stmt.condition); !res)
+      return res;
+  if (stmt.increment)
+    if (auto res = evaluate(*stmt.increment); !res)
+      return res;
+  return execute(*stmt.body);
+}
+auto Resolver::visit_impl(const statement::Function &stmt) const
+    -> eval_result_t {
+  // declared before its body is looked at, so that recursion refers to the
+  // local function rather than an outer one.
+  declare(stmt.name.to_string(utils::kTokenOnly));
+  for (const auto &name : Resolver{}.free_variables(stmt))
+    reference(name);
+  return utils::OkStatus();
+}
+auto Resolver::visit_impl(const statement::Return &stmt) const
+    -> eval_result_t {
+  if (stmt.value)
+    return evaluate(*stmt.value);
+  return utils::OkStatus();
+}
+auto Resolver::execute_impl(const statement::Stmt &stmt) const
+    -> eval_result_t {
+  return stmt.accept(*this);
+}
+auto Resolver::to_string_impl(const utils::FormatPolicy &) const
+    -> string_type {
+  return utils::format("Resolver: {} free variable(s)", free.size());
+}
 } // namespace net::ancillarycat::loxo
@@ -0,0 +1,226 @@
+#include <any>
+#include <cctype>
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/lex_error.hpp"
+#include "details/loxo_fwd.hpp"
+#include "Environment.hpp"
+#include "Token.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#include "Session.hpp"
+
+namespace net::ancillarycat::loxo {
+namespace {
+using enum TokenType::type_t;
+enum class Chunk : uint8_t { kEmpty, kIncomplete, kComplete, kIf };
+
+/// @brief whether @p tokens, the whole pending chunk, can be executed.
+auto classify(const lexer &scanner, const lexer::tokens_t &tokens) -> Chunk {
+  // the last token is always the end of file.
+  if (tokens.size() < 2)
+    return Chunk::kEmpty;
+  const auto &last = tokens[tokens.size() - 2];
+  if (last.type == kLexError)
+    if (const auto error = std::any_cast<lex_error>(&last.literal);
+        error && error->type == lex_error::kUnterminatedString)
+      return Chunk::kIncomplete;
+  // any other lex error is reported right away.
+  if (!scanner.ok())
+    return Chunk::kComplete;
+
+  auto depth = 0;
+  // where the statement being scanned and the last finished one start.
+  auto start = std::size_t{};
+  auto finished = std::size_t{};
+  for (auto i = std::size_t{}; i + 1 < tokens.size(); ++i) {
+    switch (tokens[i].type.type) {
+    case kLeftParen:
+    case kLeftBrace:
+      ++depth;
+      break;
+    case kRightParen:
+      --depth;
+      break;
+    case kRightBrace:
+    case kSemicolon:
+      if (tokens[i].type == kRightBrace)
+        --depth;
+      // `else` continues the statement before it.
+      if (!depth && tokens[i + 1].type != kElse) {
+        finished = start;
+        start = i + 1;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  if (depth < 0)
+    return Chunk::kComplete; // let the parser complain.
+  if (depth > 0 || (last.type != kSemicolon && last.type != kRightBrace))
+    return Chunk::kIncomplete;
+  return tokens[finished].type == kIf ? Chunk::kIf : Chunk::kComplete;
+}
+
+auto trimmed(const std::string_view line) -> std::string_view {
+  const auto first = line.find_first_not_of(" \t\r");
+  return first == std::string_view::npos ? std::string_view{}
+                                         : line.substr(first);
+}
+auto is_blank(const std::string_view line) -> bool {
+  const auto text = trimmed(line);
+  return text.empty() || text.starts_with("//");
+}
+auto starts_with_else(const std::string_view line) -> bool {
+  const auto text = trimmed(line);
+  return text.starts_with("else") &&
+         (text.size() == 4 ||
+          !(std::isalnum(static_cast<unsigned char>(text[4])) ||
+            text[4] == '_'));
+}
+} // namespace
+
+void Session::Progress::scan(const string_view_type line) noexcept {
+  // mirrors the lexer: strings have no escapes and may span lines, comments
+  // run to the end of the line.
+  for (auto i = std::size_t{}; i < line.size(); ++i) {
+    const auto ch = line[i];
+    if (in_string) {
+      if (ch == '"') {
+        in_string = false;
+        last = ch;
+      }
+      continue;
+    }
+    if (ch == '/' && i + 1 < line.size() && line[i + 1] == '/')
+      return;
+    if (std::isspace(static_cast<unsigned char>(ch)))
+      continue;
+    if (ch == '"')
+      in_string = true;
+    else if (ch == '(' || ch == '{')
+      ++depth;
+    else if (ch == ')' || ch == '}')
+      --depth;
+    last = ch;
+  }
+}
+
+Session::Session() : Session(Options{}) {}
+
+Session::Session(const Options &options)
+    : my_options(options), my_interpreter(std::make_unique<interpreter>()) {}
+
+Session::~Session() = default;
+
+auto Session::feed(const string_view_type line) -> utils::Status {
+  auto status = utils::OkStatus();
+  // blank lines and comments keep waiting for the `else`; anything else
+  // completes the `if`.
+  if (my_state == State::kMaybeElse && !is_blank(line) &&
+      !starts_with_else(line))
+    status = advance(true);
+  my_pending += line;
+  my_pending += '\n';
+  ++my_pending_lines;
+  my_progress.scan(line);
+  if (!status) {
+    // run the line with the next one, or on `finish`.
+    my_state = State::kIncomplete;
+    return status;
+  }
+  if (my_state != State::kMaybeElse && !my_progress.last) {
+    // nothing but blank lines and comments so far.
+    drop_pending();
+    return utils::OkStatus();
+  }
+  if (my_state != State::kMaybeElse && !my_progress.may_be_complete()) {
+    my_state = State::kIncomplete;
+    return utils::OkStatus();
+  }
+  return advance(false);
+}
+
+auto Session::finish() -> utils::Status {
+  if (my_state == State::kIdle)
+    return utils::OkStatus();
+  return advance(true);
+}
+
+auto Session::take_output() const -> string_type {
+  return my_interpreter->take_output();
+}
+
+auto Session::get_interpreter() const -> const interpreter & {
+  return *my_interpreter;
+}
+
+auto Session::advance(const bool force) -> utils::Status {
+  auto scanner = lexer{};
+  if (auto res = scanner.load(std::istringstream{my_pending}, my_line); !res) {
+    drop_pending();
+    return res;
+  }
+  if (auto res = scanner.lex(); !res) {
+    drop_pending();
+    return res;
+  }
+  const auto chunk = classify(scanner, scanner.get_tokens());
+  if (chunk == Chunk::kEmpty) {
+    drop_pending();
+    return utils::OkStatus();
+  }
+  if (!force && chunk == Chunk::kIncomplete) {
+    my_state = State::kIncomplete;
+    return utils::OkStatus();
+  }
+  if (!force && chunk == Chunk::kIf && my_options.wait_for_else) {
+    my_state = State::kMaybeElse;
+    return utils::OkStatus();
+  }
+  auto res = execute(scanner);
+  drop_pending();
+  return res;
+}
+
+auto Session::execute(lexer &scanner) -> utils::Status {
+  if (!scanner.ok()) {
+    auto message = string_type{};
+    for (const auto &token : scanner.get_tokens()) {
+      if (token.type != TokenType::kLexError)
+        continue;
+      if (!message.empty())
+        message += '\n';
+      message += token.to_string();
+    }
+    return {utils::Status::kLexError, message};
+  }
+  auto ast = parser{};
+  ast.set_views(scanner.get_tokens());
+  if (auto res = ast.parse(parser::kStatement); !res)
+    return res;
+  if (auto res = my_interpreter->interpret(ast.get_statements()); !res) {
+    my_interpreter->set_env(my_interpreter->get_global_env());
+    return res.as_status();
+  }
+  return utils::OkStatus();
+}
+
+void Session::drop_pending() noexcept {
+  my_line += my_pending_lines;
+  my_pending.clear();
+  my_pending_lines = 0;
+  my_progress = {};
+  my_state = State::kIdle;
+}
+} // namespace net::ancillarycat::loxo
@@ -0,0 +1,256 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/format.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+#include "Stats.hpp"
+
+namespace net::ancillarycat::loxo {
+namespace {
+auto operator-(const Stats::Counters &lhs, const Stats::Counters &rhs) noexcept
+    -> Stats::Counters {
+  auto result = Stats::Counters{
+      .tokens = lhs.tokens - rhs.tokens,
+      .ast_nodes = lhs.ast_nodes - rhs.ast_nodes,
+      .environments = lhs.environments - rhs.environments,
+      .calls = lhs.calls - rhs.calls,
+      .lookup_hits = lhs.lookup_hits - rhs.lookup_hits,
+      .lookup_misses = lhs.lookup_misses - rhs.lookup_misses,
+      .allocations = lhs.allocations - rhs.allocations,
+      .allocated_bytes = lhs.allocated_bytes - rhs.allocated_bytes,
+  };
+  for (auto i = std::size_t{}; i < Stats::kAllocationKinds; ++i) {
+    result.allocations_by_kind[i].count =
+        lhs.allocations_by_kind[i].count - rhs.allocations_by_kind[i].count;
+    result.allocations_by_kind[i].bytes =
+        lhs.allocations_by_kind[i].bytes - rhs.allocations_by_kind[i].bytes;
+  }
+  return result;
+}
+} // namespace
+
+Stats::Phase::Phase(Stats &stats, const string_view_type name)
+    : stats(stats), name(name), wall_start(clock_t::now()),
+      cpu_start(std::clock()), counters_start(Stats::counters()) {}
+
+Stats::Phase::~Phase() {
+  // take the snapshot first so that recording does not count itself.
+  const auto counters = Stats::counters() - counters_start;
+  const auto cpu_end = std::clock();
+  const auto wall_end = clock_t::now();
+  stats.my_records.push_back(
+      {.name = name,
+       .wall_ms =
+           std::chrono::duration<double, std::milli>(wall_end - wall_start)
+               .count(),
+       .cpu_ms = 1000.0 * static_cast<double>(cpu_end - cpu_start) /
+                 CLOCKS_PER_SEC,
+       .peak_rss_kib = Stats::peak_rss_kib(),
+       .counters = counters});
+}
+
+auto Stats::phase(const string_view_type name) -> Phase {
+  return {*this, name};
+}
+
+auto Stats::counters() noexcept -> Counters & {
+  // constant-initialized, so it is safe to touch even from `operator new`.
+  thread_local constinit auto counters = Counters{};
+  return counters;
+}
+
+auto Stats::allocation_kind() noexcept -> AllocationKind & {
+  thread_local constinit auto kind = AllocationKind::kOther;
+  return kind;
+}
+
+auto Stats::kind_name(const AllocationKind kind) noexcept
+    -> string_view_type {
+  switch (kind) {
+  case AllocationKind::kOther:
+    return "other";
+  case AllocationKind::kToken:
+    return "token";
+  case AllocationKind::kAstNode:
+    return "ast_node";
+  case AllocationKind::kEnvironment:
+    return "environment";
+  case AllocationKind::kString:
+    return "string";
+  case AllocationKind::kCallable:
+    return "callable";
+  }
+  return "unknown";
+}
+
+auto Stats::tracks_allocations() noexcept -> bool {
+#ifdef LOXO_TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+auto Stats::peak_rss_kib() noexcept -> std::uint64_t {
+#ifdef _WIN32
+  auto info = PROCESS_MEMORY_COUNTERS{};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof info))
+    return 0;
+  return static_cast<std::uint64_t>(info.PeakWorkingSetSize) / 1024;
+#else
+  auto usage = rusage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#  ifdef __APPLE__
+  return static_cast<std::uint64_t>(usage.ru_maxrss) / 1024; // bytes
+#  else
+  return static_cast<std::uint64_t>(usage.ru_maxrss); // KiB
+#  endif
+#endif
+}
+
+auto Stats::to_json() const -> string_type {
+  auto result = R"({"phases":[)"s;
+  for (auto first = true; const auto &record : my_records) {
+    if (!std::exchange(first, false))
+      result += ',';
+    result += utils::format(
+        R"({{"name":"{}","wall_ms":{:.3f},"cpu_ms":{:.3f},)"
+        R"("peak_rss_kib":{},"tokens":{},"ast_nodes":{},"environments":{},)"
+        R"("calls":{},"lookup_hits":{},"lookup_misses":{},)",
+        record.name,
+        record.wall_ms,
+        record.cpu_ms,
+        record.peak_rss_kib,
+        record.counters.tokens,
+        record.counters.ast_nodes,
+        record.counters.environments,
+        record.counters.calls,
+        record.counters.lookup_hits,
+        record.counters.lookup_misses);
+    if (!tracks_allocations()) {
+      result += R"("allocations":null,"allocated_bytes":null,)"
+                R"("allocations_by_kind":null})";
+      continue;
+    }
+    result += utils::format(
+        R"("allocations":{},"allocated_bytes":{},"allocations_by_kind":{{)",
+        record.counters.allocations,
+        record.counters.allocated_bytes);
+    for (auto i = std::size_t{}; i < kAllocationKinds; ++i)
+      result += utils::format(
+          R"({}"{}":{{"count":{},"bytes":{}}})",
+          i ? "," : "",
+          kind_name(static_cast<AllocationKind>(i)),
+          record.counters.allocations_by_kind[i].count,
+          record.counters.allocations_by_kind[i].bytes);
+    result += "}}";
+  }
+  result += "]}\n";
+  return result;
+}
+
+auto Stats::to_string_impl(const utils::FormatPolicy &) const -> string_type {
+  auto result =
+      utils::format("{:<10}{:>12}{:>12}{:>14}{:>10}{:>10}{:>10}{:>10}{:>12}"
+                    "{:>14}{:>12}{:>14}\n",
+                    "phase",
+                    "wall(ms)",
+                    "cpu(ms)",
+                    "peak rss(KiB)",
+                    "tokens",
+                    "nodes",
+                    "envs",
+                    "calls",
+                    "lookup hits",
+                    "lookup misses",
+                    "allocs",
+                    "alloc bytes");
+  const auto tracked = tracks_allocations();
+  for (const auto &record : my_records)
+    result += utils::format(
+        "{:<10}{:>12.3f}{:>12.3f}{:>14}{:>10}{:>10}{:>10}{:>10}{:>12}{:>14}"
+        "{:>12}{:>14}\n",
+        record.name,
+        record.wall_ms,
+        record.cpu_ms,
+        record.peak_rss_kib,
+        record.counters.tokens,
+        record.counters.ast_nodes,
+        record.counters.environments,
+        record.counters.calls,
+        record.counters.lookup_hits,
+        record.counters.lookup_misses,
+        tracked ? utils::format("{}", record.counters.allocations) : "n/a",
+        tracked ? utils::format("{}", record.counters.allocated_bytes)
+                : "n/a");
+
+  if (!tracked) {
+    result += "\nallocations unavailable: built without "
+              "LOXO_TRACK_ALLOCATIONS\n";
+    return result;
+  }
+
+  result += "\nallocations by kind (count / bytes):\n";
+  result += utils::format("{:<10}", "phase");
+  for (auto i = std::size_t{}; i < kAllocationKinds; ++i)
+    result +=
+        utils::format("{:>24}", kind_name(static_cast<AllocationKind>(i)));
+  result += '\n';
+  for (const auto &record : my_records) {
+    result += utils::format("{:<10}", record.name);
+    for (const auto &[count, bytes] : record.counters.allocations_by_kind)
+      result += utils::format("{:>24}", utils::format("{} / {}", count, bytes));
+    result += '\n';
+  }
+  return result;
+}
+} // namespace net::ancillarycat::loxo
+
+#ifdef LOXO_TRACK_ALLOCATIONS
+// global allocation hooks feeding `Stats::counters()`; the array and sized
+// forms of the standard library forward to these.
+void *operator new(const std::size_t size) {
+  using net::ancillarycat::loxo::Stats;
+  auto &counters = Stats::counters();
+  auto &by_kind = counters.allocations_by_kind[static_cast<std::size_t>(
+      Stats::allocation_kind())];
+  ++counters.allocations;
+  counters.allocated_bytes += size;
+  ++by_kind.count;
+  by_kind.bytes += size;
+  // what the replaced one does: give the new-handler a chance to free memory.
+  while (true) {
+    if (const auto ptr = std::malloc(size ? size : 1))
+      return ptr;
+    const auto handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc{};
+    handler();
+  }
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
@@ -32,287 +32,198 @@ Token::Token(const token_type &type,
              std::any literal,
              const uint_least32_t line)
     : type(type), lexeme(lexeme), literal(std::move(literal)), line(line) {}
-Token::string_type
-Token::number_to_string(const utils::FormatPolicy policy) const {
-  if (auto ptr = cast_literal<long double>()) {
-    // 42 -> 42.0
-    if (utils::is_integer(*ptr)) {
-      if (policy == utils::kDefault)
-        return utils::format("NUMBER {} {:.1f}", lexeme, *ptr);
-      else if (policy == utils::kTokenOnly)
-        return utils::format("{:.1f}", *ptr);
-      else {
-        dbg(critical, "unreachable code reached: {}", AC_UTILS_STACKTRACE)
-        contract_assert(false)
-        std::unreachable();
-      }
-    }
-    //  leave as is
-    if (policy == utils::kDefault)
-      return utils::format("NUMBER {} {}", lexeme, *ptr);
-    else if (policy == utils::kTokenOnly)
-      return utils::format("{}", *ptr);
-    else {
-      dbg(critical, "unreachable code reached: {}", AC_UTILS_STACKTRACE)
-      contract_assert(false)
-      std::unreachable();
-    }
-  } else {
-    dbg_block(literal = nullptr;)
-    if (policy == utils::kDefault)
-      return utils::format("NUMBER {} {}", lexeme, "<failed to access data>");
-    else if (policy == utils::kTokenOnly)
-      return utils::format("{}", "<failed to access data>");
-    else {
-      dbg(critical, "unreachable code reached: {}", AC_UTILS_STACKTRACE)
-      contract_assert(false)
-      std::unreachable();
-    }
-  }
-}
-Token::string_type
-Token::to_string_impl(const utils::FormatPolicy &policy) const {
-  using namespace std::string_literals;
-  using enum TokenType::type_t;
-  auto type_sv = ""sv;
-  auto lexeme_sv = ""sv;
-  auto literal_sv = ""sv;
-  if (!literal.has_value())
-    literal_sv = "null"sv;
-  switch (type.type) {
+using enum TokenType::type_t;
+namespace {
+/// @brief how `tokenize` names tokens of @p type, and the lexeme of those
+/// that always read the same; the latter is empty for the others.
+constexpr auto spelling(const TokenType::type_t type) noexcept
+    -> std::pair<std::string_view, std::string_view> {
+  switch (type) {
   case kMonostate:
-    type_sv = "MONOSTATE"sv;
-    lexeme_sv = "null"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"MONOSTATE"sv, "null"sv};
   case kLeftParen:
-    type_sv = "LEFT_PAREN"sv;
-    lexeme_sv = "("sv;
-    literal_sv = "null"sv;
-    break;
+    return {"LEFT_PAREN"sv, "("sv};
   case kRightParen:
-    type_sv = "RIGHT_PAREN"sv;
-    lexeme_sv = ")"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"RIGHT_PAREN"sv, ")"sv};
   case kLeftBrace:
-    type_sv = "LEFT_BRACE"sv;
-    lexeme_sv = "{"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"LEFT_BRACE"sv, "{"sv};
   case kRightBrace:
-    type_sv = "RIGHT_BRACE"sv;
-    lexeme_sv = "}"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"RIGHT_BRACE"sv, "}"sv};
   case kComma:
-    type_sv = "COMMA"sv;
-    lexeme_sv = ","sv;
-    literal_sv = "null"sv;
-    break;
+    return {"COMMA"sv, ","sv};
   case kDot:
-    type_sv = "DOT"sv;
-    lexeme_sv = "."sv;
-    literal_sv = "null"sv;
-    break;
+    return {"DOT"sv, "."sv};
   case kMinus:
-    type_sv = "MINUS"sv;
-    lexeme_sv = "-"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"MINUS"sv, "-"sv};
   case kPlus:
-    type_sv = "PLUS"sv;
-    lexeme_sv = "+"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"PLUS"sv, "+"sv};
   case kSemicolon:
-    type_sv = "SEMICOLON"sv;
-    lexeme_sv = ";"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"SEMICOLON"sv, ";"sv};
   case kSlash:
-    type_sv = "SLASH"sv;
-    lexeme_sv = "/"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"SLASH"sv, "/"sv};
   case kStar:
-    type_sv = "STAR"sv;
-    lexeme_sv = "*"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"STAR"sv, "*"sv};
   case kBang:
-    type_sv = "BANG"sv;
-    lexeme_sv = "!"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"BANG"sv, "!"sv};
   case kBangEqual:
-    type_sv = "BANG_EQUAL"sv;
-    lexeme_sv = "!="sv;
-    literal_sv = "null"sv;
-    break;
+    return {"BANG_EQUAL"sv, "!="sv};
   case kEqual:
-    type_sv = "EQUAL"sv;
-    lexeme_sv = "="sv;
-    literal_sv = "null"sv;
-    break;
+    return {"EQUAL"sv, "="sv};
   case kEqualEqual:
-    type_sv = "EQUAL_EQUAL"sv;
-    lexeme_sv = "=="sv;
-    literal_sv = "null"sv;
-    break;
+    return {"EQUAL_EQUAL"sv, "=="sv};
   case kGreater:
-    type_sv = "GREATER"sv;
-    lexeme_sv = ">"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"GREATER"sv, ">"sv};
   case kGreaterEqual:
-    type_sv = "GREATER_EQUAL"sv;
-    lexeme_sv = ">="sv;
-    literal_sv = "null"sv;
-    break;
+    return {"GREATER_EQUAL"sv, ">="sv};
   case kLess:
-    type_sv = "LESS"sv;
-    lexeme_sv = "<"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"LESS"sv, "<"sv};
   case kLessEqual:
-    type_sv = "LESS_EQUAL"sv;
-    lexeme_sv = "<="sv;
-    literal_sv = "null"sv;
-    break;
+    return {"LESS_EQUAL"sv, "<="sv};
   case kIdentifier:
-    type_sv = "IDENTIFIER"sv;
-    lexeme_sv = lexeme;
-    literal_sv = "null"sv;
-    break;
+    return {"IDENTIFIER"sv, {}};
   case kString:
-    type_sv = "STRING"sv;
-    lexeme_sv = lexeme;
-    contract_assert(lexeme_sv.front() == '"' && lexeme_sv.back() == '"')
-    if (policy == utils::FormatPolicy::kTokenOnly) {
-      // codecrafter's string lit pase output does not need `"`, so remove them
-      lexeme_sv = lexeme_sv.substr(1, lexeme_sv.size() - 2);
-    }
-    if (auto ptr = cast_literal<string_view_type>())
-      literal_sv = *ptr;
-    else
-      literal_sv = "<failed to access data>"sv;
-    if (policy == utils::kDefault)
-      contract_assert(lexeme_sv.substr(1, lexeme_sv.size() - 2), literal_sv)
-    break;
+    return {"STRING"sv, {}};
   case kNumber:
-    return number_to_string(policy);
+    return {"NUMBER"sv, {}};
   case kAnd:
-    type_sv = "AND"sv;
-    lexeme_sv = "and"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"AND"sv, "and"sv};
   case kClass:
-    type_sv = "CLASS"sv;
-    lexeme_sv = "class"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"CLASS"sv, "class"sv};
   case kElse:
-    type_sv = "ELSE"sv;
-    lexeme_sv = "else"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"ELSE"sv, "else"sv};
   case kFalse:
-    type_sv = "FALSE"sv;
-    lexeme_sv = "false"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"FALSE"sv, "false"sv};
   case kFun:
-    type_sv = "FUN"sv;
-    lexeme_sv = "fun"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"FUN"sv, "fun"sv};
   case kFor:
-    type_sv = "FOR"sv;
-    lexeme_sv = "for"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"FOR"sv, "for"sv};
   case kIf:
-    type_sv = "IF"sv;
-    lexeme_sv = "if"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"IF"sv, "if"sv};
   case kNil:
-    type_sv = "NIL"sv;
-    lexeme_sv = "nil"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"NIL"sv, "nil"sv};
   case kOr:
-    type_sv = "OR"sv;
-    lexeme_sv = "or"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"OR"sv, "or"sv};
   case kPrint:
-    type_sv = "PRINT"sv;
-    lexeme_sv = "print"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"PRINT"sv, "print"sv};
   case kReturn:
-    type_sv = "RETURN"sv;
-    lexeme_sv = "return"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"RETURN"sv, "return"sv};
   case kSuper:
-    type_sv = "SUPER"sv;
-    lexeme_sv = "super"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"SUPER"sv, "super"sv};
   case kThis:
-    type_sv = "THIS"sv;
-    lexeme_sv = "this"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"THIS"sv, "this"sv};
   case kTrue:
-    type_sv = "TRUE"sv;
-    lexeme_sv = "true"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"TRUE"sv, "true"sv};
   case kVar:
-    type_sv = "VAR"sv;
-    lexeme_sv = "var"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"VAR"sv, "var"sv};
   case kWhile:
-    type_sv = "WHILE"sv;
-    lexeme_sv = "while"sv;
-    literal_sv = "null"sv;
-    break;
+    return {"WHILE"sv, "while"sv};
   case kEndOfFile:
-    type_sv = "EOF"sv;
-    lexeme_sv = ""sv;
-    literal_sv = "null"sv;
-    break;
-  case kLexError:
+    return {"EOF"sv, ""sv};
+  default:
+    return {};
+  }
+}
+/// @brief 42 -> 42.0; leave others as is
+auto number_chars(char (&buffer)[utils::kMaxNumberChars],
+                  const long double value) -> std::string_view {
+  const auto end =
+      utils::is_integer(value)
+          ? utils::integral_to_chars(buffer, buffer + sizeof buffer, value)
+          : utils::number_to_chars(buffer, buffer + sizeof buffer, value);
+  return {buffer, end};
+}
+} // namespace
+Token::string_type
+Token::number_to_string(const utils::FormatPolicy policy) const {
+  if (auto ptr = cast_literal<long double>()) {
+    char buffer[utils::kMaxNumberChars];
+    const auto number = number_chars(buffer, *ptr);
     if (policy == utils::kDefault) {
-      // /// @note message is different from the other cases.
-      if (auto ptr = cast_literal<error_t>())
-        return ptr->to_string(lexeme, line);
-      else
-        return utils::format(
-            "[line {}] Error: {}", line, "<failed to access data>");
-    } else {
-      // do nothing
-      return ""s;
+      auto result = "NUMBER "s;
+      result.reserve(result.size() + lexeme.size() + 1 + number.size());
+      result.append(lexeme).append(1, ' ').append(number);
+      return result;
+    } else if (policy == utils::kTokenOnly)
+      return string_type{number};
+    else {
+      dbg(critical, "unreachable code reached: {}", AC_UTILS_STACKTRACE)
+      contract_assert(false)
+      std::unreachable();
+    }
+  } else {
+    dbg_block(literal = nullptr;)
+    if (policy == utils::kDefault)
+      return utils::format("NUMBER {} {}", lexeme, "<failed to access data>");
+    else if (policy == utils::kTokenOnly)
+      return utils::format("{}", "<failed to access data>");
+    else {
+      dbg(critical, "unreachable code reached: {}", AC_UTILS_STACKTRACE)
+      contract_assert(false)
+      std::unreachable();
     }
+  }
+}
+void Token::append_to(string_type &out) const {
+  const auto [type_sv, fixed_lexeme] = spelling(type.type);
+  switch (type.type) {
+  case kIdentifier:
+    out.append(type_sv).append(1, ' ').append(lexeme).append(" null"sv);
+    break;
+  case kString:
+    contract_assert(lexeme.front() == '"' && lexeme.back() == '"')
+    out.append(type_sv).append(1, ' ').append(lexeme).append(1, ' ');
+    if (auto ptr = cast_literal<string_view_type>()) {
+      contract_assert(string_view_type{lexeme}.substr(1, lexeme.size() - 2),
+                      *ptr)
+      out.append(*ptr);
+    } else
+      out.append("<failed to access data>"sv);
+    break;
+  case kNumber:
+    if (auto ptr = cast_literal<long double>()) {
+      char buffer[utils::kMaxNumberChars];
+      out.append(type_sv).append(1, ' ').append(lexeme).append(1, ' ').append(
+          number_chars(buffer, *ptr));
+    } else
+      out.append(number_to_string(utils::kDefault));
+    break;
+  case kLexError:
+    // the message is different from the other cases.
+    if (auto ptr = cast_literal<error_t>())
+      out.append(ptr->to_string(lexeme, line));
+    else
+      out.append(utils::format(
+          "[line {}] Error: {}", line, "<failed to access data>"));
+    break;
   default:
-    contract_assert(false, 1, "should not happen")
+    contract_assert(!type_sv.empty(), 1, "should not happen")
+    out.append(type_sv).append(1, ' ').append(fixed_lexeme).append(" null"sv);
     break;
   }
+}
+Token::string_type
+Token::to_string_impl(const utils::FormatPolicy &policy) const {
   if (policy == utils::kDefault) {
-    /// @note DON'T use `.data()` since it's not null-terminated and will the
-    /// string will last till the end
-    return utils::format("{} {} {}", type_sv, lexeme_sv, literal_sv);
-  } else if (policy == utils::kTokenOnly) {
-    // for ast print.
-    return utils::format("{}", lexeme_sv);
+    auto result = string_type{};
+    append_to(result);
+    return result;
+  }
+  contract_assert(policy == utils::kTokenOnly, 1, "should not happen")
+  // for ast print.
+  switch (type.type) {
+  case kIdentifier:
+    return lexeme;
+  case kString:
+    // codecrafter's string lit pase output does not need `"`, so remove them
+    contract_assert(lexeme.front() == '"' && lexeme.back() == '"')
+    return lexeme.substr(1, lexeme.size() - 2);
+  case kNumber:
+    return number_to_string(policy);
+  case kLexError:
+    return ""s;
+  default:
+    return string_type{spelling(type.type).second};
   }
-  contract_assert(false, 1, "should not happen")
-  return ""s;
 }
 
 auto format_as(const Token &token) -> Token::string_type {
@@ -0,0 +1,85 @@
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#if defined(_WIN32)
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+#include "Token.hpp"
+
+#include "TokenWriter.hpp"
+
+namespace net::ancillarycat::loxo {
+namespace {
+/// @return the errno of the failed write, or 0.
+auto write_all(const int fd, const char *data, std::size_t size) -> int {
+  while (size) {
+#if defined(_WIN32)
+    const auto written = ::_write(fd, data, static_cast<unsigned>(size));
+#else
+    const auto written = ::write(fd, data, size);
+#endif
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written < 0)
+      return errno;
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return 0;
+}
+} // namespace
+
+TokenWriter::TokenWriter(const int fd) : my_fd(fd) {
+  // room for the longest line, so that a full chunk never reallocates.
+  my_buffer.reserve(kChunkSize + 256);
+}
+
+TokenWriter::~TokenWriter() { flush().ignore_error(); }
+
+auto TokenWriter::write(const Token &token) -> TokenWriter & {
+  token.append_to(my_buffer);
+  my_buffer += '\n';
+  flush_if_full();
+  return *this;
+}
+
+auto TokenWriter::write(const string_view_type text) -> TokenWriter & {
+  my_buffer += text;
+  flush_if_full();
+  return *this;
+}
+
+auto TokenWriter::flush() -> utils::Status {
+  drain();
+  if (!my_errno)
+    return utils::OkStatus();
+  const auto status =
+      utils::Status{utils::Status::kError, std::strerror(my_errno)};
+  my_errno = 0;
+  return status;
+}
+
+void TokenWriter::flush_if_full() {
+  if (my_buffer.size() >= kChunkSize)
+    drain();
+}
+
+void TokenWriter::drain() {
+  if (my_buffer.empty())
+    return;
+  // keep the first error for flush to report.
+  if (const auto error = write_all(my_fd, my_buffer.data(), my_buffer.size());
+      !my_errno)
+    my_errno = error;
+  my_buffer.clear();
+}
+} // namespace net::ancillarycat::loxo
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/format.hpp>
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "details/loxo_fwd.hpp"
+
+#include "Tracer.hpp"
+
+namespace net::ancillarycat::loxo {
+/// @brief the events of one thread; only that thread writes to it.
+class Tracer::Ring {
+public:
+  Ring(const std::size_t capacity, const std::size_t thread_id)
+      : events(capacity), thread_id(thread_id) {}
+
+public:
+  void push(const Event &event) noexcept {
+    events[written++ % events.size()] = event;
+  }
+
+public:
+  std::vector<Event> events;
+  /// @brief how many events were ever pushed; the ring holds the last ones.
+  std::uint64_t written = 0;
+  std::size_t depth = 0;
+  std::size_t thread_id;
+};
+
+namespace {
+std::atomic<std::uint64_t> next_tracer_serial = 1;
+/// @brief the ring of the calling thread and the tracer it belongs to.
+struct ThreadState {
+  std::uint64_t serial = 0;
+  Tracer::Ring *ring = nullptr;
+};
+thread_local constinit auto thread_state = ThreadState{};
+} // namespace
+
+Tracer::Tracer() : Tracer(Options{}) {}
+
+Tracer::Tracer(const Options &options) : my_options(options) {
+  contract_assert(my_options.capacity > 0)
+}
+
+Tracer::~Tracer() { stop(); }
+
+auto Tracer::start() -> utils::Status {
+  if (active.load(std::memory_order_relaxed) == this)
+    return utils::AlreadyExistsError("the tracer is already running");
+  // a new serial gives every thread a fresh ring for this run.
+  my_serial = next_tracer_serial++;
+  my_epoch = clock_t::now();
+  if (auto expected = static_cast<Tracer *>(nullptr);
+      !active.compare_exchange_strong(
+          expected, this, std::memory_order_release, std::memory_order_relaxed))
+    return utils::AlreadyExistsError("another tracer is already running");
+  return utils::OkStatus();
+}
+
+void Tracer::stop() noexcept {
+  auto expected = this;
+  active.compare_exchange_strong(expected, nullptr);
+}
+
+auto Tracer::ring() -> Ring & {
+  if (thread_state.serial == my_serial) [[likely]]
+    return *thread_state.ring;
+  const auto lock = std::scoped_lock{my_rings_mutex};
+  const auto &ring = my_rings.emplace_back(
+      std::make_unique<Ring>(my_options.capacity, my_rings.size() + 1));
+  thread_state = {my_serial, ring.get()};
+  return *ring;
+}
+
+void Tracer::Span::begin(Tracer &tracer,
+                         const string_view_type name,
+                         const line_t line) noexcept {
+  my_ring = &tracer.ring();
+  my_serial = tracer.my_serial;
+  // the depth is tracked even for spans that are not recorded.
+  my_recorded = my_ring->depth++ < tracer.my_options.max_depth;
+  my_name = name;
+  my_line = line;
+  my_start = clock_t::now();
+}
+
+void Tracer::Span::end() noexcept {
+  // the ring goes with its tracer: a span that outlives the run it began in
+  // must not touch it, and records nothing.
+  const auto tracer = active.load(std::memory_order_acquire);
+  if (!tracer || tracer->my_serial != my_serial)
+    return;
+  --my_ring->depth;
+  if (!my_recorded)
+    return;
+  const auto duration = clock_t::now() - my_start;
+  if (duration < tracer->my_options.min_duration)
+    return;
+  my_ring->push({my_name, my_line, my_start, duration});
+}
+
+auto Tracer::to_json() const -> string_type {
+  const auto to_us = [](const auto duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  };
+  auto result = string_type{R"({"displayTimeUnit":"ms","traceEvents":[)"};
+  result += R"({"name":"process_name","ph":"M","pid":1,"tid":0,)"
+            R"("args":{"name":"loxo"}})";
+
+  const auto lock = std::scoped_lock{my_rings_mutex};
+  for (const auto &ring : my_rings) {
+    const auto size =
+        std::min<std::uint64_t>(ring->written, ring->events.size());
+    for (auto i = ring->written - size; i < ring->written; ++i) {
+      const auto &event = ring->events[i % ring->events.size()];
+      result += utils::format(
+          R"(,{{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f})",
+          event.name,
+          ring->thread_id,
+          to_us(event.start - my_epoch),
+          to_us(event.duration));
+      if (event.line)
+        result += utils::format(R"(,"args":{{"line":{}}})", event.line);
+      result += '}';
+    }
+    if (ring->written > size)
+      result += utils::format(
+          R"(,{{"name":"dropped_events","ph":"i","s":"t","pid":1,"tid":{},)"
+          R"("ts":0,"args":{{"count":{}}}}})",
+          ring->thread_id,
+          ring->written - size);
+  }
+  result += "]}\n";
+  return result;
+}
+
+auto Tracer::write(const path_type &path) const -> utils::Status {
+  auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+    return utils::PermissionDeniedError("cannot open trace output file");
+  file << to_json();
+  return utils::OkStatus();
+}
+} // namespace net::ancillarycat::loxo
@@ -1,3 +1,5 @@
+#include <any>
+#include <memory>
 #include <string>
 
 #include "details/loxo_fwd.hpp"
@@ -7,7 +9,24 @@
 #include "Evaluatable.hpp"
 
 namespace net::ancillarycat::loxo::expression {
-Literal::Literal(token_t &&literal) : literal(std::move(literal)) {}
+Literal::Literal(token_t &&literal)
+    : Expr(Kind::kLiteral), literal(std::move(literal)) {
+  using enum TokenType::type_t;
+  const auto line = this->literal.line;
+  if (this->literal.is_type(kNil))
+    value = evaluation::Nil{line};
+  else if (this->literal.is_type(kTrue))
+    value = evaluation::Boolean{true, line};
+  else if (this->literal.is_type(kFalse))
+    value = evaluation::Boolean{false, line};
+  else if (this->literal.is_type(kString))
+    value = evaluation::String::intern(
+        std::any_cast<utils::Viewable::string_view_type>(this->literal.literal),
+        line);
+  else if (this->literal.is_type(kNumber))
+    value = evaluation::Number{std::any_cast<long double>(this->literal.literal),
+                               line};
+}
 Expr::expr_result_t Literal::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
@@ -15,7 +34,7 @@ Expr::string_type Literal::to_string_impl(const utils::FormatPolicy &) const {
   return literal.to_string(utils::FormatPolicy::kTokenOnly);
 }
 Unary::Unary(token_t &&op, expr_ptr_t &&expr)
-    : op(std::move(op)), expr(std::move(expr)) {}
+    : Expr(Kind::kUnary), op(std::move(op)), expr(std::move(expr)) {}
 Expr::expr_result_t Unary::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
@@ -25,7 +44,8 @@ Unary::to_string_impl(const utils::FormatPolicy &format_policy) const {
          expr->to_string() + ")";
 }
 Binary::Binary(token_t &&op, expr_ptr_t &&left, expr_ptr_t &&right)
-    : op(std::move(op)), left(std::move(left)), right(std::move(right)) {}
+    : Expr(Kind::kBinary), op(std::move(op)), left(std::move(left)),
+      right(std::move(right)) {}
 Expr::expr_result_t Binary::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
@@ -34,7 +54,10 @@ Binary::to_string_impl(const utils::FormatPolicy &format_policy) const {
   return "(" + op.to_string(utils::FormatPolicy::kTokenOnly) + " " +
          left->to_string() + " " + right->to_string() + ")";
 }
-Variable::Variable(token_t &&name) : name(std::move(name)) {}
+Variable::Variable(token_t &&name)
+    : Expr(Kind::kVariable), name(std::move(name)) {
+  cache.name = this->name.to_string(utils::kTokenOnly);
+}
 Expr::expr_result_t Variable::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
@@ -42,7 +65,8 @@ auto Variable::to_string_impl(const utils::FormatPolicy &format_policy) const
     -> string_type {
   return name.to_string(utils::kTokenOnly);
 }
-Grouping::Grouping(expr_ptr_t &&expr) : expr(std::move(expr)) {}
+Grouping::Grouping(expr_ptr_t &&expr)
+    : Expr(Kind::kGrouping), expr(std::move(expr)) {}
 Expr::expr_result_t Grouping::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
@@ -55,20 +79,24 @@ Expr::expr_result_t Assignment::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
 Assignment::Assignment(token_t &&name, expr_ptr_t &&value)
-    : name(std::move(name)), value_expr(std::move(value)) {}
+    : Expr(Kind::kAssignment), name(std::move(name)),
+      value_expr(std::move(value)) {
+  cache.name = this->name.to_string(utils::kTokenOnly);
+}
 auto Assignment::to_string_impl(const utils::FormatPolicy &format_policy) const
     -> string_type {
   TODO()
 }
 Logical::Logical(token_t &&op, expr_ptr_t &&left, expr_ptr_t &&right)
-    : op(std::move(op)), left(std::move(left)), right(std::move(right)) {}
+    : Expr(Kind::kLogical), op(std::move(op)), left(std::move(left)),
+      right(std::move(right)) {}
 Expr::expr_result_t Logical::accept_impl(const ExprVisitor &visitor) const {
   return visitor.visit(*this);
 }
 Call::Call(expr_ptr_t &&callee,
            token_t &&paren,
            std::vector<expr_ptr_t> &&arguments)
-    : callee(std::move(callee)), paren(std::move(paren)),
+    : Expr(Kind::kCall), callee(std::move(callee)), paren(std::move(paren)),
       args(std::move(arguments)) {}
 auto Logical::to_string_impl(const utils::FormatPolicy &format_policy) const
     -> string_type {
@@ -17,6 +17,10 @@
 #include "details/loxo_fwd.hpp"
 #include "Environment.hpp"
 #include "Evaluatable.hpp"
+#include "Instrumentation.hpp"
+#include "Resolver.hpp"
+#include "Stats.hpp"
+#include "Tracer.hpp"
 #include "statement.hpp"
 #include "expression.hpp"
 #include "interpreter.hpp"
@@ -24,26 +28,21 @@
 namespace net::ancillarycat::loxo {
 using utils::match;
 using enum TokenType::type_t;
-interpreter::interpreter() : env(std::make_shared<Environment>()) {}
+interpreter::interpreter()
+    : env(Environment::createGlobalEnvironment()), global_env(env) {}
+interpreter::~interpreter() { global_env->clear(); }
 auto interpreter::interpret(
     const std::span<std::shared_ptr<statement::Stmt>> stmts) const
     -> eval_result_t {
   is_interpreting_stmts = true;
-  static bool has_init_global_env = false;
-  if (!has_init_global_env) {
-    auto maybe_env = Environment::getGlobalEnvironment();
-    if (!maybe_env)
-      return maybe_env.as_status();
-    has_init_global_env = true;
-    this->env = maybe_env.value();
-    // this->global_env = env;
-  }
 
-  for (const auto &stmt : stmts)
+  for (const auto &stmt : stmts) {
+    const auto span = Tracer::Span{"statement", stmt->line};
     if (auto eval_res = execute(*stmt); !eval_res) {
       last_expr_res->clear();
       return eval_res;
     }
+  }
 
   return utils::OkStatus();
 }
@@ -53,6 +52,11 @@ auto interpreter::set_env(const env_ptr_t &new_env) const
   env = new_env;
   return *this;
 }
+auto interpreter::set_instrumentation(
+    Instrumentation *new_instrumentation) const -> const interpreter & {
+  instrumentation = new_instrumentation;
+  return *this;
+}
 
 evaluation::Boolean
 interpreter::is_true_value(const eval_result_t &value) const {
@@ -86,9 +90,8 @@ auto interpreter::is_deep_equal(const eval_result_t &lhs,
                    }})
              : evaluation::Boolean{evaluation::False};
 }
-auto interpreter::get_call_args(const expression::Call &expr) const
-    -> utils::StatusOr<std::vector<variant_type>> {
-  auto args = std::vector<variant_type>{};
+auto interpreter::get_call_args(const expression::Call &expr,
+                                args_t &args) const -> utils::Status {
   args.reserve(expr.args.size());
 
   // we choose to evaluate argument expressions from left to right, adhering
@@ -97,10 +100,10 @@ auto interpreter::get_call_args(const expression::Call &expr) const
   for (const auto &arg : expr.args) {
     auto res = evaluate(*arg);
     if (!res)
-      return {res};
+      return {res.as_status()};
     args.emplace_back(*res);
   }
-  return {args};
+  return utils::OkStatus();
 }
 auto interpreter::visit_impl(const statement::Variable &stmt) const
     -> eval_result_t {
@@ -109,12 +112,14 @@ auto interpreter::visit_impl(const statement::Variable &stmt) const
     auto eval_res = evaluate(*stmt.initializer);
     if (!eval_res)
       return eval_res;
-    contract_assert(!!std::any_cast<string_view_type>(&stmt.name.literal),
+    // only the lexeme: the literal of a name views the source it was lexed
+    // from, which a loaded or a cached program no longer has.
+    contract_assert(stmt.name.is_type(kIdentifier),
                     1,
-                    "variable name should be a string")
+                    "variable name should be an identifier")
     dbg(trace,
         "variable name: {}, value: {}",
-        std::any_cast<string_view_type>(stmt.name.literal),
+        stmt.name.lexeme,
         eval_res->underlying_string())
     // string view failed again; not null-terminated
     return {env->add(
@@ -216,18 +221,35 @@ auto interpreter::visit_impl(const statement::Function &stmt) const
   //     )
       
 
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kCallable};
+  if (!stmt.prototype) {
+    auto prototype = std::make_shared<evaluation::FunctionPrototype>();
+    prototype->name = stmt.name.to_string(utils::kTokenOnly);
+    prototype->arity = static_cast<unsigned>(stmt.parameters.size());
+    prototype->line = stmt.name.line;
+    prototype->parameters = std::make_shared<const std::vector<string_type>>(
+        stmt.parameters
+        | std::ranges::views::transform([&](const auto &param) {
+            return param.to_string(utils::kTokenOnly);
+          })
+        | std::ranges::to<std::vector<string_type>>());
+    prototype->body = stmt.body.statements;
+    prototype->lazy_body = stmt.lazy_body;
+    prototype->upvalue_names = std::make_shared<const std::vector<string_type>>(
+        Resolver{}.free_variables(stmt));
+    stmt.prototype = std::move(prototype);
+  }
+  // declare the name first so that a recursive local function captures itself.
+  if (auto res = env->add(stmt.prototype->name,
+                          evaluation::NilValue,
+                          stmt.name.line); !res)
+    return res;
   auto callable = evaluation::Callable::create_custom(
-          stmt.parameters.size(),
-          {stmt.name.to_string(utils::kTokenOnly),
-           stmt.parameters
-           | std::ranges::views::transform([&](const auto &param) {
-               return param.to_string(utils::kTokenOnly);
-             })
-           | std::ranges::to<std::vector<string_type>>(),
-           stmt.body.statements},
-           this->env); 
+      stmt.prototype,
+      Environment::createClosureEnvironment(
+          this->env, stmt.prototype->upvalue_names));
   return env->add(
-      stmt.name.to_string(utils::kTokenOnly),
+      stmt.prototype->name,
       callable,
       stmt.name.line);
   // clang-format on
@@ -239,7 +261,7 @@ auto interpreter::visit_impl(const statement::Expression &stmt) const
 auto interpreter::visit_impl(const statement::Block &stmt) const
     -> eval_result_t {
   auto original_env = env; // save the original environment
-  auto sub_env = std::make_shared<Environment>(env);
+  auto sub_env = Environment::createScopeEnvironment(env);
   env = sub_env;
   for (const auto &scoped_stmt : stmt.statements) {
     if (auto eval_res = execute(*scoped_stmt); !eval_res) {
@@ -253,6 +275,8 @@ auto interpreter::visit_impl(const statement::Block &stmt) const
 }
 auto interpreter::execute_impl(const statement::Stmt &stmt) const
     -> eval_result_t {
+  const auto line_scope =
+      Instrumentation::LineScope{instrumentation, stmt.line};
   return stmt.accept(*this);
 }
 auto interpreter::get_result_impl() const -> eval_result_t {
@@ -269,7 +293,7 @@ auto interpreter::evaluate_impl(const expression::Expr &expr) const
 }
 auto interpreter::visit_impl(const statement::Return &expr) const
     -> eval_result_t {
-  if (this->env == *Environment::getGlobalEnvironment()) {
+  if (this->env == this->global_env) {
     return {utils::InvalidArgument("Cannot return from top-level code.")};
   }
 
@@ -293,24 +317,9 @@ auto interpreter::visit_impl(const expression::Literal &expr) const
     contract_assert(false)
     return {};
   }
-  if (expr.literal.is_type(kNil)) {
-    return {evaluation::Nil{expr.literal.line}};
-  }
-  if (expr.literal.is_type(kTrue)) {
-    return {evaluation::Boolean{true, expr.literal.line}};
-  }
-  if (expr.literal.is_type(kFalse)) {
-    return {evaluation::Boolean{false, expr.literal.line}};
-  }
-  if (expr.literal.is_type(kString)) {
-    return {evaluation::String{
-        std::any_cast<string_view_type>(expr.literal.literal),
-        expr.literal.line}};
-  }
-  if (expr.literal.is_type(kNumber)) {
-    return {evaluation::Number{std::any_cast<long double>(expr.literal.literal),
-                               expr.literal.line}};
-  }
+  // materialized by the parser; copying shares the buffer of strings.
+  if (!std::holds_alternative<utils::Monostate>(expr.value.get()))
+    return {expr.value};
   return {utils::InvalidArgument(
       utils::format("Expected literal value.\n[line {}]", expr.literal.line))};
 }
@@ -346,6 +355,14 @@ auto interpreter::visit_impl(const expression::Binary &expr) const
   if (!rhs) {
     return rhs;
   }
+  if (expr.specialization != expression::Binary::Specialization::kGeneric) {
+    if (auto res = eval_specialized(expr, lhs, rhs))
+      return {*std::move(res)};
+    // guard failed: deoptimize, the generic path below reports any error.
+    dbg(trace, "deoptimizing binary operator: {}", expr.op.to_string())
+    expr.specialization = expression::Binary::Specialization::kGeneric;
+    ++expr.deopts;
+  }
   if (expr.op.is_type(kEqualEqual)) {
     return {{is_deep_equal(lhs, rhs)}};
   }
@@ -363,6 +380,7 @@ auto interpreter::visit_impl(const expression::Binary &expr) const
   }
   if (utils::holds_alternative<evaluation::String>(*lhs)) {
     if (expr.op.is_type(kPlus)) {
+      quicken(expr, lhs);
       return {evaluation::String{utils::get<evaluation::String>(*lhs) +
                                  utils::get<evaluation::String>(*rhs)}};
     }
@@ -370,6 +388,7 @@ auto interpreter::visit_impl(const expression::Binary &expr) const
   if (utils::holds_alternative<evaluation::Number>(*lhs)) {
     auto real_lhs = utils::get<evaluation::Number>(*lhs);
     auto real_rhs = utils::get<evaluation::Number>(*rhs);
+    quicken(expr, lhs);
     switch (expr.op.type.type) {
     case kMinus:
       return {evaluation::Number{real_lhs - real_rhs}};
@@ -396,15 +415,92 @@ auto interpreter::visit_impl(const expression::Binary &expr) const
   return {utils::InvalidArgument(utils::format(
       "unimplemented binary operator.\n[line {}]", expr.op.line))};
 }
+auto interpreter::eval_specialized(const expression::Binary &expr,
+                                   const eval_result_t &lhs,
+                                   const eval_result_t &rhs) const
+    -> std::optional<variant_type> {
+  using enum expression::Binary::Specialization;
+  if (expr.specialization == kStringConcat) {
+    const auto real_lhs = std::get_if<evaluation::String>(&lhs->get());
+    const auto real_rhs = std::get_if<evaluation::String>(&rhs->get());
+    if (!real_lhs || !real_rhs)
+      return std::nullopt;
+    return {evaluation::String{*real_lhs + *real_rhs}};
+  }
+
+  const auto real_lhs = std::get_if<evaluation::Number>(&lhs->get());
+  const auto real_rhs = std::get_if<evaluation::Number>(&rhs->get());
+  if (!real_lhs || !real_rhs)
+    return std::nullopt;
+  switch (expr.specialization) {
+  case kNumberAdd:
+    return {evaluation::Number{*real_lhs + *real_rhs}};
+  case kNumberSubtract:
+    return {evaluation::Number{*real_lhs - *real_rhs}};
+  case kNumberMultiply:
+    return {evaluation::Number{*real_lhs * *real_rhs}};
+  case kNumberDivide:
+    return {evaluation::Number{*real_lhs / *real_rhs}};
+  case kNumberLess:
+    return {evaluation::Boolean{*real_lhs < *real_rhs}};
+  case kNumberLessEqual:
+    return {evaluation::Boolean{*real_lhs <= *real_rhs}};
+  case kNumberGreater:
+    return {evaluation::Boolean{*real_lhs > *real_rhs}};
+  case kNumberGreaterEqual:
+    return {evaluation::Boolean{*real_lhs >= *real_rhs}};
+  default:
+    contract_assert(false, 1, "unreachable code reached")
+    return std::nullopt;
+  }
+}
+void interpreter::quicken(const expression::Binary &expr,
+                          const eval_result_t &lhs) const {
+  using enum expression::Binary::Specialization;
+  if (expr.deopts >= expression::Binary::kMaxDeopts)
+    return;
+
+  if (std::holds_alternative<evaluation::String>(lhs->get())) {
+    expr.specialization = kStringConcat;
+    return;
+  }
+  switch (expr.op.type.type) {
+  case kMinus:
+    expr.specialization = kNumberSubtract;
+    break;
+  case kPlus:
+    expr.specialization = kNumberAdd;
+    break;
+  case kSlash:
+    expr.specialization = kNumberDivide;
+    break;
+  case kStar:
+    expr.specialization = kNumberMultiply;
+    break;
+  case kGreater:
+    expr.specialization = kNumberGreater;
+    break;
+  case kGreaterEqual:
+    expr.specialization = kNumberGreaterEqual;
+    break;
+  case kLess:
+    expr.specialization = kNumberLess;
+    break;
+  case kLessEqual:
+    expr.specialization = kNumberLessEqual;
+    break;
+  default:
+    break;
+  }
+}
 auto interpreter::visit_impl(const expression::Grouping &expr) const
     -> eval_result_t {
   return {expr.expr->accept(*this)};
 }
 auto interpreter::visit_impl(const expression::Variable &expr) const
     -> eval_result_t {
-  if (auto res = env->get(expr.name.to_string(utils::FormatPolicy::kTokenOnly));
-      !res.empty())
-    return res;
+  if (const auto value = env->find(expr.cache))
+    return {*value};
 
   return {utils::NotFoundError(
       utils::format("Undefined variable '{}'.\n[line {}]",
@@ -418,9 +514,9 @@ auto interpreter::visit_impl(const expression::Assignment &expr) const
   if (!res)
     return res;
 
-  if (!env->reassign(expr.name.to_string(utils::FormatPolicy::kTokenOnly),
-                     *res,
-                     expr.name.line))
+  if (const auto value = env->find(expr.cache))
+    *value = *res;
+  else
     return {utils::NotFoundError(
         utils::format("Undefined variable '{}'.\n[line {}]",
                       expr.name.to_string(utils::FormatPolicy::kTokenOnly),
@@ -462,29 +558,40 @@ auto interpreter::visit_impl(const expression::Call &expr) const
         "Can only call functions and classes.\n[line {}]", expr.paren.line))};
   }
 
-  auto callable = utils::get<evaluation::Callable>(*res);
-  const auto maybe_args = get_call_args(expr);
-
-  if (!maybe_args)
-    return {maybe_args.as_status()};
+  // `utils::get` would copy the callable; borrow it from `res` instead.
+  const auto &callable = std::get<evaluation::Callable>(res->get());
+  const auto argc = expr.args.size();
 
-  if (maybe_args->size() == callable.arity())
+  if (argc == callable.arity() && !callable.is_native()) {
+    // evaluate straight into the parameter slots of the new frame, so a
+    // call neither builds a temporary vector nor re-hashes the parameters.
+    auto frame = callable.make_frame();
+    if (auto status = get_call_args(expr, frame->slots()); !status.ok())
+      return {status};
     // clear `Returning` status has already been implemented in `call` method.
     // just return here.
-    return callable.call(*this, *maybe_args);
+    return callable.call(*this, std::move(frame));
+  }
+
+  auto args = args_t{};
+  if (auto status = get_call_args(expr, args); !status.ok())
+    return {status};
+
+  if (argc == callable.arity())
+    return callable.call(*this, std::move(args));
 
   return {utils::InvalidArgument(
-      maybe_args->size() > callable.arity()
+      argc > callable.arity()
           ? utils::format("Too many arguments to call function '{}': "
                           "expected {} but got {}",
                           callee->to_string(),
                           callable.arity(),
-                          maybe_args->size())
+                          argc)
           : utils::format("Too few arguments to call function '{}': "
                           "expected {} but got {}",
                           callee->to_string(),
                           callable.arity(),
-                          maybe_args->size()))};
+                          argc))};
 }
 
 auto interpreter::expr_to_string(const utils::FormatPolicy &format_policy) const
@@ -524,5 +631,10 @@ auto interpreter::to_string_impl(const utils::FormatPolicy &format_policy) const
   // clang-format on
   return result_str;
 }
+auto interpreter::take_output() const -> string_type {
+  auto result = to_string();
+  stmts_res.clear();
+  return result;
+}
 LOXO_API void delete_interpreter_fwd(interpreter *ptr) { delete ptr; }
 } // namespace net::ancillarycat::loxo
@@ -17,6 +17,8 @@
 
 #include "details/lex_error.hpp"
 #include "lexer.hpp"
+#include "Stats.hpp"
+#include "Tracer.hpp"
 #include "Token.hpp"
 
 /// @namespace net::ancillarycat::loxo
@@ -67,6 +69,7 @@ lexer &lexer::operator=(lexer &&other) noexcept {
   return *this;
 }
 lexer::status_t lexer::load(const path_type &filepath) const {
+  const auto span = Tracer::Span{"lexer::load"};
   if (not contents.empty())
     return utils::AlreadyExistsError("File already loaded");
   if (not std::filesystem::exists(filepath))
@@ -76,7 +79,9 @@ lexer::status_t lexer::load(const path_type &filepath) const {
   const_cast<string_type &>(contents) = reader.get_contents();
   return utils::OkStatus();
 }
-lexer::status_t lexer::load(const std::istream &ss) {
+lexer::status_t lexer::load(const std::istream &ss,
+                            const uint_least32_t first_line) {
+  const auto span = Tracer::Span{"lexer::load"};
   if (not contents.empty())
     return utils::AlreadyExistsError("Content already loaded");
   std::ostringstream oss;
@@ -84,15 +89,19 @@ lexer::status_t lexer::load(const std::istream &ss) {
   const_cast<string_type &>(contents) = oss.str();
   tokens.clear();
   lexeme_views.clear();
+  current_line = first_line;
   return utils::OkStatus();
 }
 
 lexer::status_t lexer::lex() {
+  const auto span = Tracer::Span{"lexer::lex"};
+  const auto tokens_before = tokens.size();
   while (not is_at_end()) {
     head = cursor;
     next_token();
   }
   add_token(kEndOfFile);
+  Stats::counters().tokens += tokens.size() - tokens_before;
   return utils::OkStatus();
 }
 void lexer::add_identifier_and_keyword() {
@@ -218,6 +227,7 @@ bool lexer::is_at_end(const size_t offset) const {
   return cursor + offset >= contents.size();
 }
 void lexer::add_token(const token_type_t &type, std::any literal) {
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kToken};
   if (type == kEndOfFile) { // FIXME: lexeme bug at EOF(not critical)
     tokens.emplace_back(type, ""sv, std::any{}, current_line);
     return;
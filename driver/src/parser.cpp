@@ -11,7 +11,15 @@
 #include "expression.hpp"
 
 #include "parser.hpp"
+#include "Stats.hpp"
+#include "Tracer.hpp"
 namespace net::ancillarycat::loxo {
+template <typename NodeTy, typename... Args>
+auto parser::make_node(Args &&...args) -> std::shared_ptr<NodeTy> {
+  ++Stats::counters().ast_nodes;
+  const auto scope = Stats::AllocationScope{Stats::AllocationKind::kAstNode};
+  return std::make_shared<NodeTy>(std::forward<Args>(args)...);
+}
 // NOLINTBEGIN(misc-no-recursion)
 parser &parser::set_views(const token_views_t tokens) {
   contract_assert(tokens.size() && tokens.back().is_type(kEndOfFile),
@@ -21,6 +29,10 @@ parser &parser::set_views(const token_views_t tokens) {
   this->cursor = tokens.begin();
   return *this;
 }
+parser &parser::set_function_bodies(const FunctionBodies bodies) noexcept {
+  this->function_bodies = bodies;
+  return *this;
+}
 bool parser::is_at_end(const size_type offset) const {
   // return cursor + offset >= tokens.end();
   /// @note: ^^^^^^ MSVC has iterator assertion on whether the iterator is past
@@ -37,6 +49,7 @@ auto parser::get(const size_type offset) -> token_t {
   return token;
 }
 auto parser::parse(const ParsePolicy &parse_policy) -> utils::Status try {
+  const auto span = Tracer::Span{"parser::parse"};
   if (parse_policy == kExpression) {
     expr_head = next_expression();
   } else if (parse_policy == kStatement) {
@@ -65,6 +78,16 @@ auto parser::get_expression() const -> expr_ptr_t & {
                   "but not `parse(kExpression)`?")
   return expr_head;
 }
+auto parser::parse_body(const token_views_t tokens, stmt_ptrs_t &statements)
+    -> utils::Status {
+  auto body = parser{};
+  body.set_views(tokens).set_function_bodies(FunctionBodies::kLazy);
+  // empty bodies are fine here, unlike in `get_statements`.
+  if (auto res = body.parse(kStatement); !res)
+    return res;
+  statements = std::move(body.stmts);
+  return utils::OkStatus();
+}
 auto parser::next_expression() -> expr_ptr_t { return assignment(); }
 auto parser::assignment() -> expr_ptr_t {
   auto expr = logical_or();
@@ -72,8 +95,8 @@ auto parser::assignment() -> expr_ptr_t {
     auto eq_op = this->get();
     auto res = assignment();
     if (auto var_name = std::dynamic_pointer_cast<expression::Variable>(expr)) {
-      return std::make_shared<expression::Assignment>(std::move(var_name->name),
-                                                      std::move(res));
+      return make_node<expression::Assignment>(std::move(var_name->name),
+                                               std::move(res));
     }
     throw synchronize({parse_error::kUnknownError, "Expect variable name."});
   }
@@ -85,7 +108,7 @@ auto parser::logical_or() -> expr_ptr_t {
     auto or_op = this->get();
     auto rhs = logical_or();
     // FIXME: move myself and reassign it??? is it legal?
-    expr = std::make_shared<expression::Logical>(
+    expr = make_node<expression::Logical>(
         std::move(or_op), std::move(expr), std::move(rhs));
   }
   return expr;
@@ -95,7 +118,7 @@ auto parser::logical_and() -> expr_ptr_t {
   while (inspect(kAnd)) {
     auto eq_op = this->get();
     auto rhs = equality();
-    expr = std::make_shared<expression::Logical>(
+    expr = make_node<expression::Logical>(
         std::move(eq_op), std::move(expr), std::move(rhs));
   }
   return expr;
@@ -105,7 +128,7 @@ auto parser::equality() -> expr_ptr_t {
   while (inspect(kEqualEqual, kBangEqual)) {
     auto op = this->get();
     auto rhs = comparison();
-    equalityExpr = std::make_shared<expression::Binary>(
+    equalityExpr = make_node<expression::Binary>(
         std::move(op), std::move(equalityExpr), std::move(rhs));
   }
   return equalityExpr;
@@ -115,7 +138,7 @@ auto parser::comparison() -> expr_ptr_t {
   while (inspect(kGreater, kGreaterEqual, kLess, kLessEqual)) {
     auto op = this->get();
     auto rhs = term();
-    comparisonExpr = std::make_shared<expression::Binary>(
+    comparisonExpr = make_node<expression::Binary>(
         std::move(op), std::move(comparisonExpr), std::move(rhs));
   }
   return comparisonExpr;
@@ -125,7 +148,7 @@ auto parser::term() -> expr_ptr_t {
   while (inspect(kMinus, kPlus)) {
     auto op = this->get();
     auto rhs = factor();
-    termExpr = std::make_shared<expression::Binary>(
+    termExpr = make_node<expression::Binary>(
         std::move(op), std::move(termExpr), std::move(rhs));
   }
   return termExpr;
@@ -135,7 +158,7 @@ auto parser::factor() -> expr_ptr_t {
   while (inspect(kSlash, kStar)) {
     auto op = this->get();
     auto rhs = unary();
-    factorExpr = std::make_shared<expression::Binary>(
+    factorExpr = make_node<expression::Binary>(
         std::move(op), std::move(factorExpr), std::move(rhs));
   }
   return factorExpr;
@@ -144,7 +167,7 @@ auto parser::unary() -> expr_ptr_t {
   if (inspect(kBang, kMinus)) {
     auto op = this->get();
     auto rhs = unary();
-    return std::make_shared<expression::Unary>(std::move(op), std::move(rhs));
+    return make_node<expression::Unary>(std::move(op), std::move(rhs));
   }
   return call();
 }
@@ -153,24 +176,24 @@ auto parser::call() -> expr_ptr_t {
   while (inspect(kLeftParen)) {
     auto paren = this->get();
     auto args = get_args();
-    expr = std::make_shared<expression::Call>(
+    expr = make_node<expression::Call>(
         std::move(expr), std::move(paren), std::move(args));
   }
   return expr;
 }
 auto parser::primary() -> expr_ptr_t {
   if (inspect(kFalse))
-    return std::make_shared<expression::Literal>(this->get());
+    return make_node<expression::Literal>(this->get());
   if (inspect(kTrue))
-    return std::make_shared<expression::Literal>(this->get());
+    return make_node<expression::Literal>(this->get());
   if (inspect(kNil))
-    return std::make_shared<expression::Literal>(this->get());
+    return make_node<expression::Literal>(this->get());
   if (inspect(kNumber))
-    return std::make_shared<expression::Literal>(this->get());
+    return make_node<expression::Literal>(this->get());
   if (inspect(kString))
-    return std::make_shared<expression::Literal>(this->get());
+    return make_node<expression::Literal>(this->get());
   if (inspect(kIdentifier)) {
-    return std::make_shared<expression::Variable>(this->get());
+    return make_node<expression::Variable>(this->get());
   }
   ///  where's keyword??????????????
   ///     ^^^^^^ solved: shoud not appera here and was already handled in lexer.
@@ -195,7 +218,7 @@ auto parser::primary() -> expr_ptr_t {
           {parse_error::kMissingParenthesis, "Expect expression."});
     }
     this->get();
-    return std::make_shared<expression::Grouping>(std::move(expr));
+    return make_node<expression::Grouping>(std::move(expr));
   }
   // invalid evaluation reached
   throw synchronize({parse_error::kUnknownError, "Expect expression."});
@@ -250,16 +273,31 @@ auto parser::get_stmts() -> stmt_ptrs_t {
   this->get();
   return statements;
 }
+void parser::skip_body() {
+  for (auto depth = 1; depth;) {
+    if (is_at_end()) {
+      throw synchronize({parse_error::kMissingBrace, "Expect '}'."});
+    }
+    if (inspect(kLeftBrace))
+      ++depth;
+    else if (inspect(kRightBrace))
+      --depth;
+    this->get();
+  }
+}
 auto parser::next_declaration() -> stmt_ptr_t {
+  const auto line = peek().line;
+  stmt_ptr_t stmt;
   if (inspect(kVar)) {
     this->get();
-    return var_decl();
-  }
-  if (inspect(kFun)) {
+    stmt = var_decl();
+  } else if (inspect(kFun)) {
     this->get();
-    return function_decl();
-  }
-  return next_statement();
+    stmt = function_decl();
+  } else
+    return next_statement();
+  stmt->line = line;
+  return stmt;
 }
 auto parser::var_decl() -> stmt_ptr_t {
 
@@ -276,8 +314,8 @@ auto parser::var_decl() -> stmt_ptr_t {
     throw synchronize({parse_error::kUnknownError, "Expect expression."});
   }
   this->get();
-  return std::make_shared<statement::Variable>(std::move(var_tok),
-                                               std::move(initializer));
+  return make_node<statement::Variable>(std::move(var_tok),
+                                        std::move(initializer));
 }
 auto parser::function_decl() -> stmt_ptr_t {
   auto name = this->get();
@@ -291,8 +329,22 @@ auto parser::function_decl() -> stmt_ptr_t {
     throw synchronize({parse_error::kMissingBrace, "Expect '{'."});
   }
   this->get();
-  return std::make_shared<statement::Function>(
-      std::move(name), std::move(parameters), get_stmts());
+  if (function_bodies == FunctionBodies::kEager)
+    return make_node<statement::Function>(
+        std::move(name), std::move(parameters), get_stmts());
+
+  const auto first = cursor;
+  if (function_bodies == FunctionBodies::kLazyChecked)
+    get_stmts(); // reports what `kEager` would; the tree is dropped.
+  else
+    skip_body();
+  const auto &right_brace = *(cursor - 1);
+  auto tokens = std::vector<token_t>(first, cursor - 1);
+  tokens.emplace_back(kEndOfFile, string_type{}, std::any{}, right_brace.line);
+  return make_node<statement::Function>(
+      std::move(name),
+      std::move(parameters),
+      std::make_shared<statement::LazyBody>(std::move(tokens)));
 }
 auto parser::get_condition() -> expr_ptr_t {
   if (!inspect(kLeftParen)) {
@@ -314,17 +366,16 @@ auto parser::if_stmt() -> stmt_ptr_t {
     this->get();
     else_branch = next_statement();
   }
-  return std::make_shared<statement::If>(
+  return make_node<statement::If>(
       std::move(condition), std::move(then_branch), std::move(else_branch));
 }
 auto parser::block_stmt() -> stmt_ptr_t {
-  return std::make_shared<statement::Block>(get_stmts());
+  return make_node<statement::Block>(get_stmts());
 }
 auto parser::while_stmt() -> stmt_ptr_t {
   auto condition = get_condition();
   auto body = next_statement();
-  return std::make_shared<statement::While>(std::move(condition),
-                                            std::move(body));
+  return make_node<statement::While>(std::move(condition), std::move(body));
 }
 auto parser::for_stmt() -> stmt_ptr_t {
   if (!inspect(kLeftParen)) {
@@ -332,6 +383,7 @@ auto parser::for_stmt() -> stmt_ptr_t {
   }
   this->get();
   stmt_ptr_t initializer = nullptr;
+  const auto initializer_line = peek().line;
   if (inspect(kVar)) {
     this->get();
     initializer = var_decl();
@@ -341,6 +393,8 @@ auto parser::for_stmt() -> stmt_ptr_t {
   } else {
     initializer = expr_stmt();
   }
+  if (initializer)
+    initializer->line = initializer_line;
   /// @note ^^^^^^ actually C's grammar was more relaxed and allows for any
   ///   declaration or statement in the initializer part of the for loop.
   ///   here we only allow for variable declaration or expression statement.
@@ -363,10 +417,10 @@ auto parser::for_stmt() -> stmt_ptr_t {
   }
   this->get();
   auto body = next_statement();
-  return std::make_shared<statement::For>(std::move(initializer),
-                                          std::move(condition),
-                                          std::move(increment),
-                                          std::move(body));
+  return make_node<statement::For>(std::move(initializer),
+                                   std::move(condition),
+                                   std::move(increment),
+                                   std::move(body));
 }
 auto parser::return_stmt() -> stmt_ptr_t {
   expr_ptr_t value = nullptr;
@@ -377,7 +431,7 @@ auto parser::return_stmt() -> stmt_ptr_t {
     throw synchronize({parse_error::kUnknownError, "Expect ';'."});
   }
   this->get();
-  return std::make_shared<statement::Return>(std::move(value));
+  return make_node<statement::Return>(std::move(value));
 }
 auto parser::print_stmt() -> stmt_ptr_t {
   auto value = next_expression();
@@ -385,7 +439,7 @@ auto parser::print_stmt() -> stmt_ptr_t {
     throw synchronize({parse_error::kUnknownError, "Expect expression."});
   }
   this->get();
-  return std::make_shared<statement::Print>(std::move(value));
+  return make_node<statement::Print>(std::move(value));
 }
 auto parser::expr_stmt() -> stmt_ptr_t {
   auto expr = next_expression();
@@ -393,34 +447,39 @@ auto parser::expr_stmt() -> stmt_ptr_t {
     throw synchronize({parse_error::kUnknownError, "Expect expression."});
   }
   this->get();
-  return std::make_shared<statement::Expression>(std::move(expr));
+  return make_node<statement::Expression>(std::move(expr));
 }
 auto parser::next_statement() -> stmt_ptr_t {
-  if (inspect(kPrint)) {
-    this->get();
-    return print_stmt();
-  }
-  if (inspect(kLeftBrace)) {
-    this->get();
-    return block_stmt();
-  }
-  if (inspect(kIf)) {
-    this->get();
-    return if_stmt();
-  }
-  if (inspect(kWhile)) {
-    this->get();
-    return while_stmt();
-  }
-  if (inspect(kFor)) {
-    this->get();
-    return for_stmt();
-  }
-  if (inspect(kReturn)) {
-    this->get();
-    return return_stmt();
-  }
-  return expr_stmt();
+  const auto line = peek().line;
+  auto stmt = [this]() -> stmt_ptr_t {
+    if (inspect(kPrint)) {
+      this->get();
+      return print_stmt();
+    }
+    if (inspect(kLeftBrace)) {
+      this->get();
+      return block_stmt();
+    }
+    if (inspect(kIf)) {
+      this->get();
+      return if_stmt();
+    }
+    if (inspect(kWhile)) {
+      this->get();
+      return while_stmt();
+    }
+    if (inspect(kFor)) {
+      this->get();
+      return for_stmt();
+    }
+    if (inspect(kReturn)) {
+      this->get();
+      return return_stmt();
+    }
+    return expr_stmt();
+  }();
+  stmt->line = line;
+  return stmt;
 }
 auto parser::synchronize(const parse_error &parse_error) -> utils::Status {
   /// advance until we have a semicolon
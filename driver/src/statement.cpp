@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <utility>
+#include <vector>
 #include <cmath>
 #include <net/ancillarycat/utils/Status.hpp>
 
@@ -8,6 +10,7 @@
 #include "statement.hpp"
 
 #include "expression.hpp"
+#include "parser.hpp"
 #include "StmtVisitor.hpp"
 
 namespace net::ancillarycat::loxo::statement {
@@ -69,6 +72,36 @@ auto If::to_string_impl(const utils::FormatPolicy &format_policy) const
   }
   return result;
 }
+LazyBody::LazyBody(std::vector<token_t> &&tokens)
+    : my_tokens(std::move(tokens)) {
+  contract_assert(!my_tokens.empty() && my_tokens.back().is_type(
+                                            TokenType::kEndOfFile))
+  // the literals still point into the source the lexer read; point them into
+  // the copied lexemes instead, which stay where they are from now on.
+  for (auto &token : my_tokens)
+    if (token.is_type(TokenType::kString))
+      token.literal = token_t::string_view_type{token.lexeme}.substr(
+          1, token.lexeme.size() - 2);
+    else if (token.is_type(TokenType::kIdentifier))
+      token.literal = token_t::string_view_type{token.lexeme};
+}
+auto LazyBody::parse() -> utils::Status {
+  if (is_parsed())
+    return my_status;
+  my_status = parser::parse_body(my_tokens, my_statements);
+  // the tokens of the statements are copies whose literals still view the
+  // lexemes here, so these stay for as long as the body does.
+  my_parsed = true;
+  return my_status;
+}
+auto LazyBody::identifiers() const -> std::vector<string_type> {
+  auto names = std::vector<string_type>{};
+  for (const auto &token : my_tokens)
+    if (token.is_type(TokenType::kIdentifier) &&
+        std::ranges::find(names, token.lexeme) == names.end())
+      names.emplace_back(token.lexeme);
+  return names;
+}
 auto Function::to_string_impl(const utils::FormatPolicy &format_policy) const
     -> string_type {
   string_type result = "function " + this->name.to_string(format_policy) + "(";
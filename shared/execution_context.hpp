@@ -1,10 +1,15 @@
 #pragma once
 
+#include <charconv>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <filesystem>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <print>
 #include <string>
 #include <string_view>
 #include <unordered_set>
@@ -26,6 +31,16 @@ struct ExecutionContext;
 
 [[nodiscard]]
 extern int loxo_main(_In_ int, _In_ char **, _Inout_ ExecutionContext &);
+/// @brief `serve`: answer `run` requests on a Unix domain socket until
+/// SIGINT or SIGTERM; keeps the parsed scripts and the process warm.
+[[nodiscard]]
+extern int loxo_serve(_Inout_ ExecutionContext &);
+/// @brief send `run <file>` to the server listening on @p socket_path and
+/// print its answer.
+/// @return the exit code, or nothing if the command needs the local driver
+/// or no server answered.
+[[nodiscard]]
+extern std::optional<int> loxo_forward(_In_ int, _In_ char **, _In_ const char *);
 /// @brief mimic from llvm clang-driver's ToolContext
 struct ExecutionContext {
   inline explicit ExecutionContext()
@@ -33,6 +48,14 @@ struct ExecutionContext {
         interpreter(nullptr, &delete_interpreter_fwd) {}
   inline ~ExecutionContext() = default;
   enum commands_t : uint16_t;
+  /// @brief how `--stats` reports, if at all.
+  enum class stats_format_t : uint8_t { none, text, json };
+  /// @brief how `parse` prints the tree: `--format=bin` and `--format=json`
+  /// dump the whole program through @link ASTWriter @endlink.
+  enum class ast_format_t : uint8_t { sexpr, binary, json };
+  /// @brief `--lazy-functions`: parse function bodies on their first call;
+  /// `=checked` still reports their syntax errors up front.
+  enum class function_bodies_t : uint8_t { eager, lazy, lazy_checked };
   std::filesystem::path executable_name;
   std::string_view executable_path;
   std::vector<commands_t> commands;
@@ -41,12 +64,26 @@ struct ExecutionContext {
   std::ostringstream output_stream{};
   std::ostringstream error_stream{};
   std::vector<std::filesystem::path> input_files;
+  stats_format_t stats_format = stats_format_t::none;
+  ast_format_t ast_format = ast_format_t::sexpr;
+  function_bodies_t function_bodies = function_bodies_t::eager;
+  /// @brief where `--profile` writes the folded stacks; empty if disabled.
+  std::filesystem::path profile_output;
+  /// @brief `--counts`: report per-function and per-line execution counters.
+  bool count_executions = false;
+  /// @brief where `--trace` writes the trace events; empty if disabled.
+  std::filesystem::path trace_output;
+  /// @brief `--workers`: how many requests `serve` runs at a time; 0 means
+  /// one per hardware thread.
+  unsigned workers = 0;
   std::unique_ptr<class lexer, decltype(&delete_lexer_fwd)> lexer;
   std::unique_ptr<class parser, decltype(&delete_parser_fwd)> parser;
   std::unique_ptr<class interpreter, decltype(&delete_interpreter_fwd)>
       interpreter;
   // std::vector<std::filesystem::path> output_files;
   void addCommands(char **&);
+  /// @return whether @p arg was a recognized `--option`
+  bool addOption(std::string_view);
   static ExecutionContext &inspectArgs(int, char **&, char **&);
   static std::string_view command_sv(const commands_t &);
 };
@@ -61,12 +98,13 @@ static inline constexpr uint16_t _repl_ = 1 << 5;
 static inline constexpr uint16_t _stdin_ = 1 << 6;
 static inline constexpr uint16_t _version_ = 1 << 7;
 static inline constexpr uint16_t _test_ = 1 << 8;
+static inline constexpr uint16_t _serve_ = 1 << 9;
 
 static inline constexpr uint16_t _needs_lex_ =
     _lex_ | _parse_ | _evaluate_ | _interpret_;
 static inline constexpr uint16_t _needs_parse_ =
     _parse_ | _evaluate_ | _interpret_;
-static inline constexpr uint16_t _enable_cli_cmd_ = _repl_ | _stdin_;
+static inline constexpr uint16_t _enable_cli_cmd_ = _repl_ | _stdin_ | _serve_;
 
 /// @note MSVC has wired behavior with my enums; also the `|` operator inside
 /// enum, so I made a workaround here.
@@ -88,6 +126,7 @@ enum ExecutionContext::commands_t : uint16_t {
   stream = details::_stdin_,
   version = details::_version_,
   test = details::_test_,
+  serve = details::_serve_,
   needs_lex = details::_needs_lex_,
   needs_parse = details::_needs_parse_,
   needs_evaluate = details::_needs_evaluate_,
@@ -110,6 +149,8 @@ inline void ExecutionContext::addCommands(char **&argv) {
     commands.emplace_back(commands_t::REPL);
   } else if (std::string_view(*(argv + 1)) == "stdin") {
     commands.emplace_back(commands_t::stream);
+  } else if (std::string_view(*(argv + 1)) == "serve") {
+    commands.emplace_back(commands_t::serve);
   } else if (std::string_view(*(argv + 1)) == "test") {
     commands.emplace_back(commands_t::test);
   } else if (std::string_view(*(argv + 1)) == "help") {
@@ -119,6 +160,37 @@ inline void ExecutionContext::addCommands(char **&argv) {
   } else
     dbg(critical, "Unknown command: {}", *(argv + 1))
 }
+inline bool ExecutionContext::addOption(const std::string_view arg) {
+  if (arg == "--stats" || arg == "--stats=text") {
+    stats_format = stats_format_t::text;
+  } else if (arg == "--stats=json") {
+    stats_format = stats_format_t::json;
+  } else if (arg == "--format=sexpr") {
+    ast_format = ast_format_t::sexpr;
+  } else if (arg == "--format=bin") {
+    ast_format = ast_format_t::binary;
+  } else if (arg == "--format=json") {
+    ast_format = ast_format_t::json;
+  } else if (arg == "--lazy-functions") {
+    function_bodies = function_bodies_t::lazy;
+  } else if (arg == "--lazy-functions=checked") {
+    function_bodies = function_bodies_t::lazy_checked;
+  } else if (arg == "--counts") {
+    count_executions = true;
+  } else if (arg.starts_with("--profile=") && arg.size() > 10) {
+    profile_output = arg.substr(10);
+  } else if (arg.starts_with("--trace=") && arg.size() > 8) {
+    trace_output = arg.substr(8);
+  } else if (arg.starts_with("--workers=") && arg.size() > 10) {
+    const auto value = arg.substr(10);
+    if (std::from_chars(value.data(), value.data() + value.size(), workers)
+            .ec != std::errc{})
+      return false;
+  } else {
+    return false;
+  }
+  return true;
+}
 inline ExecutionContext &
 ExecutionContext::inspectArgs(const int argc, char **&argv, char **&envp) {
   static auto ctx = ExecutionContext{};
@@ -138,11 +210,17 @@ ExecutionContext::inspectArgs(const int argc, char **&argv, char **&envp) {
     return ctx;
   }
   // for now: ignore envp, accept only one file
-  if (argc > 3) {
-    dbg(error, "currently only one file is supported.")
-  }
   for (auto i = 2ull; *(argv + i); ++i) {
-    ctx.input_files.emplace_back(*(argv + i));
+    if (const auto arg = std::string_view(*(argv + i)); !arg.starts_with("--"))
+      ctx.input_files.emplace_back(arg);
+    else if (!ctx.addOption(arg)) {
+      // a misspelled option would otherwise silently run with the defaults.
+      std::println(stderr, "Unknown option: {}", arg);
+      std::exit(1);
+    }
+  }
+  if (ctx.input_files.size() > 1) {
+    dbg(error, "currently only one file is supported.")
   }
 #ifdef AC_CPP_DEBUG
   // set to nullptr for debugging
@@ -172,6 +250,8 @@ inline std::string_view ExecutionContext::command_sv(const commands_t &cmd) {
     return "repl"sv;
   case stream:
     return "stdin"sv;
+  case serve:
+    return "serve"sv;
   default:
     return "unknown"sv;
   }
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "config.hpp"
+
+namespace net::ancillarycat::utils {
+/// @brief a vector that keeps its first @p InlineCapacity elements inside the
+/// object itself and only falls back to the heap when it grows past that.
+/// @note mimic from llvm's `SmallVector`; only the operations the interpreter
+/// needs are provided. Growing past the inline capacity invalidates pointers
+/// to the elements, just like @link std::vector @endlink.
+template <typename Ty, std::size_t InlineCapacity> class SmallVector {
+  static_assert(InlineCapacity > 0, "use std::vector instead");
+
+public:
+  using value_type = Ty;
+  using size_type = std::size_t;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using iterator = value_type *;
+  using const_iterator = const value_type *;
+
+public:
+  SmallVector() noexcept = default;
+  SmallVector(const SmallVector &that) {
+    reserve(that.my_size);
+    std::uninitialized_copy_n(that.my_data, that.my_size, my_data);
+    my_size = that.my_size;
+  }
+  SmallVector(SmallVector &&that) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>) {
+    steal(std::move(that));
+  }
+  auto operator=(const SmallVector &that) -> SmallVector & {
+    if (this == &that)
+      return *this;
+    clear();
+    reserve(that.my_size);
+    std::uninitialized_copy_n(that.my_data, that.my_size, my_data);
+    my_size = that.my_size;
+    return *this;
+  }
+  auto operator=(SmallVector &&that) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>) -> SmallVector & {
+    if (this == &that)
+      return *this;
+    clear();
+    release_heap();
+    steal(std::move(that));
+    return *this;
+  }
+  ~SmallVector() {
+    clear();
+    release_heap();
+  }
+
+public:
+  template <typename... Args> auto emplace_back(Args &&...args) -> reference {
+    if (my_size == my_capacity)
+      return grow_and_emplace_back(std::forward<Args>(args)...);
+    auto ptr = std::construct_at(my_data + my_size, std::forward<Args>(args)...);
+    ++my_size;
+    return *ptr;
+  }
+  auto push_back(const value_type &value) -> reference {
+    return emplace_back(value);
+  }
+  auto push_back(value_type &&value) -> reference {
+    return emplace_back(std::move(value));
+  }
+  void pop_back() noexcept {
+    contract_assert(my_size > 0)
+    std::destroy_at(my_data + --my_size);
+  }
+  void reserve(const size_type new_capacity) {
+    if (new_capacity > my_capacity)
+      grow(new_capacity);
+  }
+  void clear() noexcept {
+    std::destroy_n(my_data, my_size);
+    my_size = 0;
+  }
+
+public:
+  auto size() const noexcept -> size_type { return my_size; }
+  auto capacity() const noexcept -> size_type { return my_capacity; }
+  auto empty() const noexcept -> bool { return my_size == 0; }
+  /// @brief whether the elements still live in the inline buffer
+  auto is_inline() const noexcept -> bool {
+    return my_data == inline_data();
+  }
+  auto data() noexcept -> value_type * { return my_data; }
+  auto data() const noexcept -> const value_type * { return my_data; }
+  auto begin() noexcept -> iterator { return my_data; }
+  auto begin() const noexcept -> const_iterator { return my_data; }
+  auto end() noexcept -> iterator { return my_data + my_size; }
+  auto end() const noexcept -> const_iterator { return my_data + my_size; }
+  auto operator[](const size_type index) noexcept -> reference {
+    contract_assert(index < my_size)
+    return my_data[index];
+  }
+  auto operator[](const size_type index) const noexcept -> const_reference {
+    contract_assert(index < my_size)
+    return my_data[index];
+  }
+  auto back() noexcept -> reference {
+    contract_assert(my_size > 0)
+    return my_data[my_size - 1];
+  }
+  auto back() const noexcept -> const_reference {
+    contract_assert(my_size > 0)
+    return my_data[my_size - 1];
+  }
+
+private:
+  auto inline_data() noexcept -> value_type * {
+    return std::launder(reinterpret_cast<value_type *>(my_storage));
+  }
+  auto inline_data() const noexcept -> const value_type * {
+    return std::launder(reinterpret_cast<const value_type *>(my_storage));
+  }
+  void grow(const size_type new_capacity) {
+    auto new_data = std::allocator<value_type>{}.allocate(new_capacity);
+    std::uninitialized_move_n(my_data, my_size, new_data);
+    std::destroy_n(my_data, my_size);
+    release_heap();
+    my_data = new_data;
+    my_capacity = new_capacity;
+  }
+  /// @brief the new element is built before the old buffer goes, since
+  /// @p args may refer to an element of it, as in `v.push_back(v[0])`.
+  template <typename... Args>
+  auto grow_and_emplace_back(Args &&...args) -> reference {
+    const auto new_capacity = my_capacity * 2;
+    auto new_data = std::allocator<value_type>{}.allocate(new_capacity);
+    value_type *ptr = nullptr;
+    try {
+      ptr = std::construct_at(new_data + my_size, std::forward<Args>(args)...);
+    } catch (...) {
+      std::allocator<value_type>{}.deallocate(new_data, new_capacity);
+      throw;
+    }
+    std::uninitialized_move_n(my_data, my_size, new_data);
+    std::destroy_n(my_data, my_size);
+    release_heap();
+    my_data = new_data;
+    my_capacity = new_capacity;
+    ++my_size;
+    return *ptr;
+  }
+  void release_heap() noexcept {
+    if (!is_inline())
+      std::allocator<value_type>{}.deallocate(my_data, my_capacity);
+    my_data = inline_data();
+    my_capacity = InlineCapacity;
+  }
+  /// @pre `*this` is empty and uses the inline buffer
+  void steal(SmallVector &&that) {
+    if (that.is_inline()) {
+      std::uninitialized_move_n(that.my_data, that.my_size, my_data);
+      my_size = that.my_size;
+      that.clear();
+      return;
+    }
+    my_data = std::exchange(that.my_data, that.inline_data());
+    my_size = std::exchange(that.my_size, 0);
+    my_capacity = std::exchange(that.my_capacity, InlineCapacity);
+  }
+
+private:
+  value_type *my_data = inline_data();
+  size_type my_size = 0;
+  size_type my_capacity = InlineCapacity;
+  alignas(value_type) std::byte my_storage[sizeof(value_type) * InlineCapacity];
+};
+} // namespace net::ancillarycat::utils
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <any>
+#include <charconv>
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 #include <string>
@@ -72,6 +74,48 @@ template <typename Ty>
 bool is_integer(Ty &&value) noexcept {
   return std::trunc(std::forward<Ty>(value)) == value;
 }
+/// @brief the shortest text that reads back as @p value; exactly what
+/// `format("{}", value)` produces, without parsing a format string.
+/// @return past-the-end of the written characters.
+/// @pre the buffer holds at least @link kMaxNumberChars @endlink characters.
+inline constexpr auto kMaxNumberChars = std::size_t{64};
+inline auto number_to_chars(char *first, char *last, const long double value)
+    -> char * {
+  return std::to_chars(first, last, value).ptr;
+}
+/// @brief integer fast path of the above, for integers that are exactly
+/// representable as a `long double`.
+inline auto number_to_chars(char *first, char *last, const std::int64_t value)
+    -> char * {
+  const auto end = std::to_chars(first, last, value).ptr;
+  // shortest representation prefers scientific notation only if it is
+  // strictly shorter, e.g. `1e+06` over `1000000`.
+  const auto sign = value < 0 ? 1 : 0;
+  const auto digits = end - first - sign;
+  auto significant = digits;
+  while (significant > 1 && end[significant - digits - 1] == '0')
+    --significant;
+  const auto exponent = digits - 1;
+  const auto scientific = significant + (significant > 1 ? 1 : 0) + 2 +
+                          (exponent >= 100 ? 3 : 2);
+  if (digits <= scientific)
+    return end;
+  return number_to_chars(first, last, static_cast<long double>(value));
+}
+/// @brief `format("{:.1f}", value)`, as used for integral numbers in the
+/// token dump (`42` -> `42.0`).
+inline auto integral_to_chars(char *first, char *last, const long double value)
+    -> char * {
+  constexpr auto limit = static_cast<long double>(std::int64_t{1} << 62);
+  if (value > -limit && value < limit && !(value == 0 && std::signbit(value))) {
+    auto end =
+        std::to_chars(first, last, static_cast<std::int64_t>(value)).ptr;
+    *end++ = '.';
+    *end++ = '0';
+    return end;
+  }
+  return std::to_chars(first, last, value, std::chars_format::fixed, 1).ptr;
+}
 template <typename... Ts> struct match : Ts... {
   using Ts::operator()...;
 };
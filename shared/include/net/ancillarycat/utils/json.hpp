@@ -0,0 +1,299 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// @brief a small JSON reader for the tools of this repository (the AST
+/// loader, the benchmark comparison); not a general purpose library.
+/// @note numbers are read as `double`; `\u` escapes are decoded to UTF-8. The
+/// input is checked strictly, since it may come from other programs. Only the
+/// standard library is used, so that tools without the interpreter's
+/// dependencies can include it.
+namespace net::ancillarycat::utils::json {
+struct Value;
+using Array = std::vector<Value>;
+/// @brief the last of duplicate keys wins.
+using Object = std::map<std::string, Value, std::less<>>;
+struct Value {
+  std::variant<std::nullptr_t, bool, double, std::string, Array, Object> data;
+
+  auto is_null() const noexcept {
+    return std::holds_alternative<std::nullptr_t>(data);
+  }
+  auto is_object() const noexcept {
+    return std::holds_alternative<Object>(data);
+  }
+  auto is_array() const noexcept { return std::holds_alternative<Array>(data); }
+  auto as_array() const -> const Array & { return std::get<Array>(data); }
+  auto as_object() const -> const Object & { return std::get<Object>(data); }
+  /// @brief the member @p key of an object, if any.
+  auto find(const std::string_view key) const -> const Value * {
+    if (!is_object())
+      return nullptr;
+    const auto &object = as_object();
+    const auto it = object.find(key);
+    return it == object.end() ? nullptr : &it->second;
+  }
+  auto boolean() const -> std::optional<bool> {
+    if (const auto ptr = std::get_if<bool>(&data))
+      return *ptr;
+    return std::nullopt;
+  }
+  auto number() const -> std::optional<double> {
+    if (const auto ptr = std::get_if<double>(&data))
+      return *ptr;
+    return std::nullopt;
+  }
+  auto string() const -> std::optional<std::string_view> {
+    if (const auto ptr = std::get_if<std::string>(&data))
+      return *ptr;
+    return std::nullopt;
+  }
+};
+
+/// @brief deeper nesting is rejected rather than overflowing the stack.
+inline constexpr std::size_t kMaxDepth = 256;
+
+namespace details {
+class Parser {
+public:
+  Parser(const std::string_view text, const std::size_t max_depth) noexcept
+      : text(text), max_depth(max_depth) {}
+
+public:
+  auto parse() -> std::optional<Value> {
+    auto result = value(0);
+    skip_whitespace();
+    if (result && pos != text.size())
+      return fail("trailing characters after the JSON document");
+    return result;
+  }
+  auto error() && -> std::string { return std::move(message); }
+
+private:
+  auto value(const std::size_t depth) -> std::optional<Value> {
+    if (depth > max_depth)
+      return fail("JSON nested too deeply");
+    skip_whitespace();
+    switch (peek()) {
+    case '{':
+      return object(depth);
+    case '[':
+      return array(depth);
+    case '"':
+      if (auto result = string())
+        return Value{std::move(*result)};
+      return std::nullopt;
+    case 't':
+      return keyword("true") ? std::optional{Value{true}} : std::nullopt;
+    case 'f':
+      return keyword("false") ? std::optional{Value{false}} : std::nullopt;
+    case 'n':
+      return keyword("null") ? std::optional{Value{nullptr}} : std::nullopt;
+    default:
+      return number();
+    }
+  }
+  auto object(const std::size_t depth) -> std::optional<Value> {
+    ++pos; // {
+    auto result = Object{};
+    if (skip_whitespace(); consume('}'))
+      return Value{std::move(result)};
+    do {
+      skip_whitespace();
+      auto key = string();
+      if (!key)
+        return std::nullopt;
+      if (skip_whitespace(); !consume(':'))
+        return fail("expected ':' in the JSON document");
+      auto member = value(depth + 1);
+      if (!member)
+        return std::nullopt;
+      result.insert_or_assign(std::move(*key), std::move(*member));
+      skip_whitespace();
+    } while (consume(','));
+    if (!consume('}'))
+      return fail("expected '}' in the JSON document");
+    return Value{std::move(result)};
+  }
+  auto array(const std::size_t depth) -> std::optional<Value> {
+    ++pos; // [
+    auto result = Array{};
+    if (skip_whitespace(); consume(']'))
+      return Value{std::move(result)};
+    do {
+      auto item = value(depth + 1);
+      if (!item)
+        return std::nullopt;
+      result.emplace_back(std::move(*item));
+      skip_whitespace();
+    } while (consume(','));
+    if (!consume(']'))
+      return fail("expected ']' in the JSON document");
+    return Value{std::move(result)};
+  }
+  auto string() -> std::optional<std::string> {
+    if (!consume('"'))
+      return fail("expected '\"' in the JSON document");
+    auto result = std::string{};
+    while (pos < text.size()) {
+      const auto ch = text[pos++];
+      if (ch == '"')
+        return result;
+      if (static_cast<unsigned char>(ch) < 0x20)
+        return fail("control character in a JSON string");
+      if (ch != '\\') {
+        result += ch;
+        continue;
+      }
+      if (pos == text.size())
+        break;
+      switch (const auto escaped = text[pos++]) {
+      case '"':
+      case '\\':
+      case '/':
+        result += escaped;
+        break;
+      case 'b':
+        result += '\b';
+        break;
+      case 'f':
+        result += '\f';
+        break;
+      case 'n':
+        result += '\n';
+        break;
+      case 'r':
+        result += '\r';
+        break;
+      case 't':
+        result += '\t';
+        break;
+      case 'u':
+        if (const auto cp = code_point())
+          append_utf8(result, *cp);
+        else
+          return std::nullopt;
+        break;
+      default:
+        return fail("invalid escape in a JSON string");
+      }
+    }
+    return fail("unexpected end of the JSON document");
+  }
+  auto code_point() -> std::optional<char32_t> {
+    const auto unit = hex4();
+    if (!unit)
+      return std::nullopt;
+    if (*unit >= 0xdc00 && *unit <= 0xdfff)
+      return fail("unpaired surrogate in a JSON string");
+    if (*unit < 0xd800 || *unit > 0xdbff)
+      return unit;
+    if (!text.substr(pos).starts_with("\\u"))
+      return fail("unpaired surrogate in a JSON string");
+    pos += 2;
+    const auto low = hex4();
+    if (!low)
+      return std::nullopt;
+    if (*low < 0xdc00 || *low > 0xdfff)
+      return fail("unpaired surrogate in a JSON string");
+    return 0x10000 + ((*unit - 0xd800) << 10) + (*low - 0xdc00);
+  }
+  auto hex4() -> std::optional<char32_t> {
+    auto unit = 0u;
+    const auto digits = text.substr(pos, 4);
+    if (digits.size() != 4 ||
+        std::from_chars(digits.data(), digits.data() + 4, unit, 16).ptr !=
+            digits.data() + 4)
+      return fail("invalid \\u escape in a JSON string");
+    pos += 4;
+    return static_cast<char32_t>(unit);
+  }
+  static void append_utf8(std::string &out, const char32_t cp) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xc0 | cp >> 6);
+      out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xe0 | cp >> 12);
+      out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+      out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+      out += static_cast<char>(0xf0 | cp >> 18);
+      out += static_cast<char>(0x80 | (cp >> 12 & 0x3f));
+      out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+      out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+  }
+  auto number() -> std::optional<Value> {
+    // `from_chars` alone would take `inf` and `nan` as well.
+    const auto first = pos;
+    while (pos < text.size() &&
+           std::string_view{"+-.0123456789eE"}.contains(text[pos]))
+      ++pos;
+    auto result = 0.0;
+    const auto [end, ec] =
+        std::from_chars(text.data() + first, text.data() + pos, result);
+    if (first == pos || ec != std::errc{} || end != text.data() + pos)
+      return fail("invalid JSON value");
+    return Value{result};
+  }
+  auto keyword(const std::string_view word) -> bool {
+    if (!text.substr(pos).starts_with(word)) {
+      fail("invalid JSON value");
+      return false;
+    }
+    pos += word.size();
+    return true;
+  }
+  void skip_whitespace() noexcept {
+    while (pos < text.size() &&
+           std::string_view{" \t\r\n"}.contains(text[pos]))
+      ++pos;
+  }
+  auto peek() const noexcept -> char {
+    return pos < text.size() ? text[pos] : '\0';
+  }
+  auto consume(const char ch) noexcept -> bool {
+    if (peek() != ch)
+      return false;
+    ++pos;
+    return true;
+  }
+  /// @brief keep the first error, which is where the document went wrong.
+  auto fail(const std::string_view what) -> std::nullopt_t {
+    if (message.empty())
+      message = std::string{what} + " at offset " + std::to_string(pos);
+    return std::nullopt;
+  }
+
+private:
+  std::string_view text;
+  std::size_t max_depth;
+  std::size_t pos = 0;
+  std::string message;
+};
+} // namespace details
+
+/// @brief parse a whole document; empty if it is not valid JSON.
+/// @param error if given, receives why and where the document is invalid.
+inline auto parse(const std::string_view text,
+                  std::string *const error = nullptr,
+                  const std::size_t max_depth = kMaxDepth)
+    -> std::optional<Value> {
+  auto parser = details::Parser{text, max_depth};
+  auto result = parser.parse();
+  if (!result && error)
+    *error = std::move(parser).error();
+  return result;
+}
+} // namespace net::ancillarycat::utils::json
@@ -1,7 +1,13 @@
 #include <algorithm>
 #include <cstddef>
+#include <iostream>
 #include <print>
 #include <ranges>
+#include <string>
+#if defined(_WIN32)
+#  include <fcntl.h>
+#  include <io.h>
+#endif
 #if __has_include(<spdlog/spdlog.h>)
 #  include <spdlog/spdlog.h>
 #endif
@@ -22,8 +28,15 @@
 #include "execution_context.hpp"
 #include "lexer.hpp"
 #include "ASTPrinter.hpp"
+#include "ASTWriter.hpp"
 #include "parser.hpp"
 #include "interpreter.hpp"
+#include "Instrumentation.hpp"
+#include "Profiler.hpp"
+#include "Session.hpp"
+#include "Stats.hpp"
+#include "TokenWriter.hpp"
+#include "Tracer.hpp"
 
 namespace net::ancillarycat::loxo {
 utils::Status show_msg() {
@@ -52,17 +65,37 @@ utils::Status onCommandNotFound(const ExecutionContext &ctx) {
 }
 void writeLexResultsToContextStream(ExecutionContext &ctx,
                                     const lexer::tokens_t &tokens) {
-  std::ranges::for_each(tokens, [&ctx](const auto &token) {
-    if (token.type == TokenType::kLexError) {
-      ctx.error_stream << token.to_string() << std::endl;
-    }
-  });
-  std::ranges::for_each(tokens, [&ctx](const auto &token) {
-    if (token.type != TokenType::kLexError) {
-      ctx.output_stream << token.to_string() << std::endl;
-    }
+  auto line = std::string{};
+  std::ranges::for_each(tokens, [&](const auto &token) {
+    line.clear();
+    token.append_to(line);
+    line += '\n';
+    (token.type == TokenType::kLexError ? ctx.error_stream : ctx.output_stream)
+        << line;
   });
 }
+/// @brief `tokenize` straight to stdout and stderr: the errors first, then the
+/// tokens and the extra line break it always ended with.
+utils::Status writeLexResultsToStdStreams(const lexer &scanner) {
+  // whatever went through the iostreams so far comes first.
+  std::cout.flush();
+  std::cerr.flush();
+  const auto &tokens = scanner.get_tokens();
+  if (scanner.error()) {
+    auto err = TokenWriter{2};
+    for (const auto &token : tokens)
+      if (token.type == TokenType::kLexError)
+        err.write(token);
+    if (auto res = err.flush(); !res)
+      return res;
+  }
+  auto out = TokenWriter{1};
+  for (const auto &token : tokens)
+    if (token.type != TokenType::kLexError)
+      out.write(token);
+  out.write("\n");
+  return out.flush();
+}
 utils::Status tokenize(ExecutionContext &ctx) {
   if (ctx.input_files.size() != 1) {
     return show_msg();
@@ -87,10 +120,22 @@ utils::Status parse(ExecutionContext &ctx) {
   dbg(info, "Parsing...")
   ctx.parser.reset(new parser);
   ctx.parser->set_views(ctx.lexer->get_tokens());
+  {
+    // only matters to whole programs; the dumps write lazy bodies as well.
+    using enum ExecutionContext::function_bodies_t;
+    ctx.parser->set_function_bodies(
+        ctx.function_bodies == lazy         ? parser::FunctionBodies::kLazy
+        : ctx.function_bodies == lazy_checked
+            ? parser::FunctionBodies::kLazyChecked
+            : parser::FunctionBodies::kEager);
+  }
   utils::Status res;
-  if (ctx.commands.front() ==
-      ExecutionContext::parse) { // NOLINT(bugprone-branch-clone)
-    res = ctx.parser->parse(parser::kExpression);
+  if (ctx.commands.front() == ExecutionContext::parse) {
+    // the dumps cover whole programs; the printer only expressions.
+    res = ctx.parser->parse(
+        ctx.ast_format == ExecutionContext::ast_format_t::sexpr
+            ? parser::kExpression
+            : parser::kStatement);
   } else if (ctx.commands.front() & ExecutionContext::needs_evaluate) {
     res = ctx.parser->parse(parser::kExpression);
   } else if (ctx.commands.front() & ExecutionContext::needs_interpret) {
@@ -108,9 +153,11 @@ utils::Status evaluate(ExecutionContext &ctx) {
   dbg(info, "evaluation completed.")
   return res;
 }
-utils::Status interpret(ExecutionContext &ctx) {
+utils::Status interpret(ExecutionContext &ctx,
+                        Instrumentation *instrumentation) {
   dbg(info, "interpreting...")
   ctx.interpreter.reset(new interpreter);
+  ctx.interpreter->set_instrumentation(instrumentation);
   auto res = ctx.interpreter->interpret(ctx.parser->get_statements());
   dbg(info, "interpretation completed.")
   return res;
@@ -121,6 +168,21 @@ void writeParseResultToContextStream(ExecutionContext &ctx) {
   contract_assert(res.ok())
   ctx.output_stream << astPrinter.to_string();
 }
+/// @brief `parse --format=bin|json`: serialize the whole program to @p out
+/// in one write; nothing is written if a lazy function body does not parse.
+auto writeProgramToStream(const ExecutionContext &ctx, std::ostream &out)
+    -> utils::Status {
+  const auto is_json = ctx.ast_format == ExecutionContext::ast_format_t::json;
+  auto writer = ASTWriter{is_json ? ASTWriter::Format::kJson
+                                  : ASTWriter::Format::kBinary};
+  if (auto res = writer.write(ctx.parser->get_statements()); !res)
+    return res;
+  const auto program = writer.view();
+  out.write(program.data(), static_cast<std::streamsize>(program.size()));
+  if (is_json)
+    out << '\n';
+  return utils::OkStatus();
+}
 void writeExprResultToContextStream(ExecutionContext &ctx) {
   // add missing newline character
   ctx.output_stream << ctx.interpreter->to_string() << std::endl;
@@ -129,6 +191,67 @@ void writeInterpResultToContextStream(ExecutionContext &ctx) {
   // DONT add newline character
   ctx.output_stream << ctx.interpreter->to_string();
 }
+/// @brief `repl`: execute every complete declaration read from @p in right
+/// away; the globals live on between them, and errors do not end the session.
+int repl(std::istream &in, std::ostream &out, std::ostream &err) {
+  auto session = Session{};
+  const auto prompt = [&] {
+    out << (session.state() == Session::State::kIdle ? "> " : "... ")
+        << std::flush;
+  };
+  auto line = std::string{};
+  for (prompt(); std::getline(in, line); prompt()) {
+    const auto res = session.feed(line);
+    out << session.take_output() << std::flush;
+    if (!res)
+      err << res.message() << std::endl;
+  }
+  const auto res = session.finish();
+  out << session.take_output() << std::endl;
+  if (!res)
+    err << res.message() << std::endl;
+  return 0;
+}
+/// @brief `stdin`: execute the top-level declarations read from @p in as they
+/// arrive and flush their output right away; the first error ends the run
+/// with the exit code `run` would give it.
+int stream(std::istream &in, std::ostream &out, std::ostream &err) {
+  auto session = Session{{.wait_for_else = true}};
+  auto res = utils::OkStatus();
+  auto line = std::string{};
+  while (res && std::getline(in, line)) {
+    res = session.feed(line);
+    out << session.take_output() << std::flush;
+  }
+  if (res) {
+    res = session.finish();
+    out << session.take_output() << std::flush;
+  }
+  if (res)
+    return 0;
+  err << res.message() << std::endl;
+  return res.code() == utils::Status::kLexError ||
+                 res.code() == utils::Status::kParseError
+             ? 65
+             : 70;
+}
+/// @brief run @p phase, recording it into @p stats if `--stats` is on.
+template <typename Fn>
+utils::Status measure(Stats *stats, const std::string_view name, Fn &&phase) {
+  if (!stats) [[likely]]
+    return phase();
+  const auto scope = stats->phase(name);
+  return phase();
+}
+void writeStatsToStream(const ExecutionContext &ctx,
+                        const Stats &stats,
+                        std::ostream &os) {
+  using enum ExecutionContext::stats_format_t;
+  if (ctx.stats_format == json)
+    os << stats.to_json();
+  else if (ctx.stats_format == text)
+    os << stats.to_string();
+}
 // clang-format off
 [[nodiscard]]
 int loxo_main(_In_ const int argc,
@@ -147,25 +270,59 @@ int loxo_main(_In_ const int argc,
     std::println(stderr, "No command provided.");
     return 1;
   }
+  if (ctx.commands.front() == ExecutionContext::REPL)
+    return repl(std::cin,
+                argv ? std::cout : ctx.output_stream,
+                argv ? std::cerr : ctx.error_stream);
+  if (ctx.commands.front() == ExecutionContext::stream)
+    return stream(std::cin,
+                  argv ? std::cout : ctx.output_stream,
+                  argv ? std::cerr : ctx.error_stream);
+  if (ctx.commands.front() == ExecutionContext::serve)
+    return loxo_serve(ctx);
   if (ctx.input_files.empty()) {
     std::println(stderr, "No input files provided.");
     return 1;
   }
+  auto tracer = Tracer{};
+  if (!ctx.trace_output.empty()) {
+    if (auto res = tracer.start(); !res)
+      dbg(error, "Tracer failed to start: {}", res.message())
+  }
+  defer {
+    if (ctx.trace_output.empty())
+      return;
+    tracer.stop();
+    if (auto res = tracer.write(ctx.trace_output); !res)
+      std::println(stderr, "Failed to write trace: {}", res.message());
+  };
+  auto stats = Stats{};
+  const auto stats_ptr =
+      ctx.stats_format == ExecutionContext::stats_format_t::none ? nullptr
+                                                                 : &stats;
+  defer {
+    if (stats_ptr)
+      writeStatsToStream(ctx, stats, argv ? std::cerr : ctx.error_stream);
+  };
   utils::Status lex_result;
   if (ctx.commands.front() & ExecutionContext::needs_lex) {
-    lex_result = tokenize(ctx);
+    lex_result = measure(stats_ptr, "lex", [&] { return tokenize(ctx); });
   }
   if (ctx.commands.front() == ExecutionContext::lex) {
-    auto tokens = ctx.lexer->get_tokens();
-    writeLexResultsToContextStream(ctx, tokens);
     // codecrafter's test needs stdout and stderr
-    std::cerr << ctx.error_stream.str();
-    std::cout << ctx.output_stream.str() << std::endl;
+    if (argv) {
+      if (auto res = writeLexResultsToStdStreams(*ctx.lexer); !res)
+        dbg(error, "Failed to write the tokens: {}", res.message())
+    } else {
+      writeLexResultsToContextStream(ctx, ctx.lexer->get_tokens());
+      std::cerr << ctx.error_stream.str();
+      std::cout << ctx.output_stream.str() << std::endl;
+    }
     return lex_result.ok() ? 0 : 65;
   }
   utils::Status parse_result;
   if (ctx.commands.front() & ExecutionContext::needs_parse) {
-    parse_result = parse(ctx);
+    parse_result = measure(stats_ptr, "parse", [&] { return parse(ctx); });
   }
   if (!parse_result.ok()) {
     dbg(error, "Parsing failed: {}", parse_result.message())
@@ -175,6 +332,26 @@ int loxo_main(_In_ const int argc,
       std::cerr << parse_result.message() << std::endl;
     return 65;
   }
+  if (ctx.commands.front() == ExecutionContext::parse &&
+      ctx.ast_format != ExecutionContext::ast_format_t::sexpr) {
+#if defined(_WIN32)
+    // no newline translation in the binary form.
+    if (argv)
+      _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    if (auto res =
+            writeProgramToStream(ctx, argv ? std::cout : ctx.output_stream);
+        !res) {
+      // a lazy function body that does not parse.
+      ctx.error_stream << res.message() << std::endl;
+      if (argv)
+        std::cerr << res.message() << std::endl;
+      return 65;
+    }
+    if (argv)
+      std::cout.flush();
+    return 0;
+  }
   if (ctx.commands.front() == ExecutionContext::parse) {
     writeParseResultToContextStream(ctx);
     if (argv)
@@ -182,9 +359,22 @@ int loxo_main(_In_ const int argc,
     return 0;
   }
 
+  auto profiler = Profiler{};
+  if (!ctx.profile_output.empty()) {
+    if (auto res = profiler.start(); !res)
+      dbg(error, "Profiler failed to start: {}", res.message())
+  }
+  defer {
+    if (ctx.profile_output.empty())
+      return;
+    profiler.stop();
+    if (auto res = profiler.write(ctx.profile_output); !res)
+      std::println(stderr, "Failed to write profile: {}", res.message());
+  };
   utils::Status evaluate_result;
   if (ctx.commands.front() & ExecutionContext::needs_evaluate) {
-    evaluate_result = evaluate(ctx);
+    evaluate_result =
+        measure(stats_ptr, "evaluate", [&] { return evaluate(ctx); });
   }
   if (ctx.commands.front() == ExecutionContext::evaluate) {
     if (evaluate_result.ok()) {
@@ -201,9 +391,20 @@ int loxo_main(_In_ const int argc,
       return 70;
     }
   }
+  auto instrumentation = Instrumentation{};
+  defer {
+    if (!ctx.count_executions)
+      return;
+    if (ctx.interpreter)
+      ctx.interpreter->set_instrumentation(nullptr);
+    (argv ? std::cerr : ctx.error_stream) << instrumentation.to_string();
+  };
   utils::Status interpret_result;
   if (ctx.commands.front() & ExecutionContext::needs_interpret) {
-    interpret_result = interpret(ctx);
+    interpret_result = measure(stats_ptr, "interpret", [&] {
+      return interpret(
+          ctx, ctx.count_executions ? &instrumentation : nullptr);
+    });
   }
   if (ctx.commands.front() == ExecutionContext::interpret) {
     writeInterpResultToContextStream(ctx);
@@ -219,7 +420,8 @@ int loxo_main(_In_ const int argc,
         std::cout << ctx.output_stream.view();
       if (argv)
         std::cerr << ctx.error_stream.view(); // DONT add newline character
-      return 70;
+      // a lazy function body that does not parse fails on its first call.
+      return interpret_result.code() == utils::Status::kParseError ? 65 : 70;
     }
   }
   return onCommandNotFound(ctx).code();
@@ -0,0 +1,486 @@
+/// @file loxo_server.cpp
+/// @brief `serve`: a long-running interpreter process that answers `run`
+/// requests over a Unix domain socket, and the client side of it.
+/// @note the wire format is a sequence of fields, each a little-endian u32
+/// followed, for strings, by that many bytes:
+///   request:  argument count, the arguments after argv[0], script source
+///   response: exit code, stdout, stderr
+/// The client sends the script itself, so the server needs neither the
+/// client's working directory nor access to its files.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#if !defined(_WIN32)
+#  include <cerrno>
+#  include <condition_variable>
+#  include <csignal>
+#  include <cstring>
+#  include <deque>
+#  include <functional>
+#  include <mutex>
+#  include <stop_token>
+#  include <thread>
+#  include <unordered_map>
+#  include <poll.h>
+#  include <pthread.h>
+#  include <sys/socket.h>
+#  include <sys/time.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+#include <net/ancillarycat/utils/config.hpp>
+#include <net/ancillarycat/utils/Status.hpp>
+
+#include "execution_context.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "statement.hpp"
+
+namespace net::ancillarycat::loxo {
+#if !defined(_WIN32)
+namespace {
+using statements_t = std::vector<std::shared_ptr<statement::Stmt>>;
+
+/// @brief no field is larger than this; guards against garbage lengths.
+constexpr std::uint32_t kMaxField = 64u << 20;
+/// @brief how many scripts the server keeps parsed.
+constexpr std::size_t kCacheCapacity = 256;
+/// @brief a client that goes silent this long in the middle of a request is
+/// dropped, so that it cannot hold a worker forever.
+constexpr auto kReceiveTimeoutSeconds = 5;
+#  if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#  else
+constexpr int kSendFlags = 0;
+#  endif
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+struct Response {
+  int exit_code = 0;
+  std::string out;
+  std::string err;
+};
+
+void put_u32(std::string &message, const std::uint32_t value) {
+  for (auto shift = 0; shift < 32; shift += 8)
+    message += static_cast<char>((value >> shift) & 0xff);
+}
+void put_field(std::string &message, const std::string_view field) {
+  put_u32(message, static_cast<std::uint32_t>(field.size()));
+  message += field;
+}
+auto write_all(const int fd, std::string_view data) -> bool {
+  while (!data.empty()) {
+    const auto written = ::send(fd, data.data(), data.size(), kSendFlags);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    data.remove_prefix(static_cast<std::size_t>(written));
+  }
+  return true;
+}
+auto read_exact(const int fd, char *data, std::size_t size) -> bool {
+  while (size) {
+    const auto received = ::recv(fd, data, size, 0);
+    if (received < 0 && errno == EINTR)
+      continue;
+    if (received <= 0)
+      return false;
+    data += received;
+    size -= static_cast<std::size_t>(received);
+  }
+  return true;
+}
+auto read_u32(const int fd) -> std::optional<std::uint32_t> {
+  unsigned char bytes[4];
+  if (!read_exact(fd, reinterpret_cast<char *>(bytes), sizeof bytes))
+    return std::nullopt;
+  return bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+         static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+auto read_field(const int fd) -> std::optional<std::string> {
+  const auto size = read_u32(fd);
+  if (!size || *size > kMaxField)
+    return std::nullopt;
+  auto field = std::string(*size, '\0');
+  if (!read_exact(fd, field.data(), field.size()))
+    return std::nullopt;
+  return field;
+}
+
+auto make_address(const std::filesystem::path &path)
+    -> std::optional<sockaddr_un> {
+  auto address = sockaddr_un{};
+  address.sun_family = AF_UNIX;
+  const auto &native = path.native();
+  if (native.empty() || native.size() >= sizeof address.sun_path)
+    return std::nullopt;
+  std::ranges::copy(native, address.sun_path);
+  return address;
+}
+/// @return the connected socket, or -1.
+auto connect_to(const sockaddr_un &address) -> int {
+  const auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (::connect(fd,
+                reinterpret_cast<const sockaddr *>(&address),
+                sizeof address) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/// @brief lex and parse @p source the way `run` does.
+auto compile(const std::string &source, statements_t &statements)
+    -> utils::Status {
+  auto scanner = lexer{};
+  if (auto res = scanner.load(std::istringstream{source}); !res)
+    return res;
+  if (auto res = scanner.lex(); !res)
+    return res;
+  auto ast = parser{};
+  ast.set_views(scanner.get_tokens());
+  if (auto res = ast.parse(parser::kStatement); !res)
+    return res;
+  // the statements own their tokens, so the lexer can go.
+  statements = std::move(ast.get_statements());
+  return utils::OkStatus();
+}
+
+/// @brief a script the server has seen, parsed once for every request that
+/// runs it at the same time.
+/// @note the AST caches variable lookups and operand types in its nodes, so
+/// one parsed copy serves one request at a time; copies are handed out and
+/// put back instead of parsing per request.
+class Program {
+public:
+  Program(std::string source, const std::size_t max_idle)
+      : my_source(std::move(source)), my_max_idle(max_idle) {
+    auto statements = statements_t{};
+    if (auto res = compile(my_source, statements); !res)
+      my_error = std::move(res);
+    else
+      my_idle.emplace_back(std::move(statements));
+  }
+
+public:
+  auto source() const noexcept -> const std::string & { return my_source; }
+  /// @brief run the script in a fresh interpreter; mirrors the output and
+  /// exit code of `run`.
+  auto run() -> Response {
+    if (!my_error.ok())
+      return {65, {}, std::string{my_error.message()} + '\n'};
+    auto statements = acquire();
+    auto runner = interpreter{};
+    const auto res = runner.interpret(statements);
+    auto response = Response{0, runner.to_string(), {}};
+    release(std::move(statements));
+    if (res) {
+      response.out += '\n';
+    } else {
+      response.exit_code = 70;
+      response.err = std::string{res.message()} + '\n';
+    }
+    return response;
+  }
+
+private:
+  auto acquire() -> statements_t {
+    {
+      const auto lock = std::scoped_lock{my_mutex};
+      if (!my_idle.empty()) {
+        auto statements = std::move(my_idle.back());
+        my_idle.pop_back();
+        return statements;
+      }
+    }
+    // parsed once already, so this cannot fail.
+    auto statements = statements_t{};
+    compile(my_source, statements).ignore_error();
+    return statements;
+  }
+  void release(statements_t &&statements) {
+    const auto lock = std::scoped_lock{my_mutex};
+    if (my_idle.size() < my_max_idle)
+      my_idle.emplace_back(std::move(statements));
+  }
+
+private:
+  const std::string my_source;
+  const std::size_t my_max_idle;
+  /// @brief the lex or parse error; set once, in the constructor.
+  utils::Status my_error;
+  std::mutex my_mutex;
+  std::vector<statements_t> my_idle;
+};
+
+/// @brief the parsed scripts, keyed by the hash of their source; the least
+/// recently used one goes first.
+/// @note an evicted script takes its interned string literals along once the
+/// requests still running it are done; see @link evaluation::String::intern
+/// @endlink.
+class ProgramCache {
+public:
+  ProgramCache(const std::size_t capacity, const std::size_t copies)
+      : my_capacity(capacity), my_copies(copies) {}
+
+public:
+  auto get(std::string source) -> std::shared_ptr<Program> {
+    const auto hash = std::hash<std::string>{}(source);
+    {
+      const auto lock = std::scoped_lock{my_mutex};
+      if (const auto it = my_entries.find(hash);
+          it != my_entries.end() && it->second.program->source() == source) {
+        it->second.last_used = ++my_clock;
+        return it->second.program;
+      }
+    }
+    // parse outside of the lock; other scripts need not wait for it.
+    auto program = std::make_shared<Program>(std::move(source), my_copies);
+    const auto lock = std::scoped_lock{my_mutex};
+    if (const auto it = my_entries.find(hash);
+        it == my_entries.end() && my_entries.size() >= my_capacity)
+      my_entries.erase(std::ranges::min_element(my_entries, {}, [](auto &entry) {
+        return entry.second.last_used;
+      }));
+    // a colliding script replaces the cached one.
+    my_entries.insert_or_assign(hash, Entry{program, ++my_clock});
+    return program;
+  }
+
+private:
+  struct Entry {
+    std::shared_ptr<Program> program;
+    std::uint64_t last_used = 0;
+  };
+
+private:
+  const std::size_t my_capacity;
+  const std::size_t my_copies;
+  std::mutex my_mutex;
+  std::unordered_map<std::size_t, Entry> my_entries;
+  std::uint64_t my_clock = 0;
+};
+
+/// @brief accepted connections, answered by a fixed number of workers.
+class WorkerPool {
+public:
+  explicit WorkerPool(const unsigned workers)
+      : my_programs(kCacheCapacity, workers) {
+    for (auto i = 0u; i < workers; ++i)
+      my_workers.emplace_back([this](const std::stop_token stop) { work(stop); });
+  }
+  WorkerPool(const WorkerPool &) = delete;
+  auto operator=(const WorkerPool &) = delete;
+  ~WorkerPool() {
+    for (auto &worker : my_workers)
+      worker.request_stop();
+    my_workers.clear();
+    for (const auto fd : my_pending)
+      ::close(fd);
+  }
+
+public:
+  void submit(const int fd) {
+    {
+      const auto lock = std::scoped_lock{my_mutex};
+      my_pending.push_back(fd);
+    }
+    my_ready.notify_one();
+  }
+
+private:
+  void work(const std::stop_token stop) {
+    while (true) {
+      auto fd = -1;
+      {
+        auto lock = std::unique_lock{my_mutex};
+        if (!my_ready.wait(lock, stop, [this] { return !my_pending.empty(); }))
+          return;
+        fd = my_pending.front();
+        my_pending.pop_front();
+      }
+      answer(fd);
+      ::close(fd);
+    }
+  }
+  void answer(const int fd) {
+    const auto argc = read_u32(fd);
+    if (!argc || *argc > 64)
+      return;
+    auto args = std::vector<std::string>{};
+    for (auto i = 0u; i < *argc; ++i) {
+      auto arg = read_field(fd);
+      if (!arg)
+        return;
+      args.emplace_back(std::move(*arg));
+    }
+    auto source = read_field(fd);
+    if (!source)
+      return;
+    const auto response =
+        args.empty() || args.front() != "run"
+            ? Response{1, {}, "serve only answers `run`.\n"}
+            : my_programs.get(std::move(*source))->run();
+    auto message = std::string{};
+    put_u32(message, static_cast<std::uint32_t>(response.exit_code));
+    put_field(message, response.out);
+    put_field(message, response.err);
+    write_all(fd, message);
+  }
+
+private:
+  ProgramCache my_programs;
+  std::mutex my_mutex;
+  std::condition_variable_any my_ready;
+  std::deque<int> my_pending;
+  /// @brief last, so that the workers are gone before what they use.
+  std::vector<std::jthread> my_workers;
+};
+
+void on_stop_signal(int) { stop_requested = 1; }
+} // namespace
+
+int loxo_serve(ExecutionContext &ctx) {
+  const auto socket_path = ctx.input_files.empty()
+                               ? ctx.tempdir / "loxo.sock"
+                               : ctx.input_files.front();
+  const auto address = make_address(socket_path);
+  if (!address) {
+    std::println(stderr, "Invalid socket path: {}", socket_path.string());
+    return 1;
+  }
+  if (const auto fd = connect_to(*address); fd >= 0) {
+    ::close(fd);
+    std::println(stderr, "Already served: {}", socket_path.string());
+    return 1;
+  }
+  // nobody answers on it, so it was left behind by a server that died.
+  ::unlink(address->sun_path);
+  const auto listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 ||
+      ::bind(listener,
+             reinterpret_cast<const sockaddr *>(&*address),
+             sizeof *address) < 0 ||
+      ::listen(listener, SOMAXCONN) < 0) {
+    std::println(stderr,
+                 "Failed to listen on {}: {}",
+                 socket_path.string(),
+                 std::strerror(errno));
+    if (listener >= 0)
+      ::close(listener);
+    return 1;
+  }
+  defer {
+    ::close(listener);
+    ::unlink(address->sun_path);
+  };
+
+  // the workers must not take the stop signals, which have to interrupt the
+  // accepting thread.
+  auto stop_signals = sigset_t{};
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  auto previous_mask = sigset_t{};
+  ::pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_mask);
+  const auto workers =
+      ctx.workers ? ctx.workers
+                  : std::max(1u, std::thread::hardware_concurrency());
+  auto pool = WorkerPool{workers};
+  ::pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+  // a server started again in the same process, as the tests do, must not
+  // see the stop of the previous one.
+  stop_requested = 0;
+  struct sigaction action = {};
+  action.sa_handler = on_stop_signal;
+  sigemptyset(&action.sa_mask);
+  ::sigaction(SIGINT, &action, nullptr);
+  ::sigaction(SIGTERM, &action, nullptr);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  std::println(stderr,
+               "Serving on {} with {} worker(s).",
+               socket_path.string(),
+               workers);
+  const auto timeout = timeval{.tv_sec = kReceiveTimeoutSeconds, .tv_usec = 0};
+  while (!stop_requested) {
+    // wake up now and then, in case the signal came in between the check and
+    // the poll.
+    auto ready = pollfd{.fd = listener, .events = POLLIN, .revents = 0};
+    if (::poll(&ready, 1, 250) <= 0)
+      continue;
+    const auto fd = ::accept(listener, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    pool.submit(fd);
+  }
+  return 0;
+}
+
+std::optional<int>
+loxo_forward(const int argc, char **argv, const char *socket_path) {
+  // anything but a plain `run <file>` needs the local driver.
+  if (argc != 3 || std::string_view{argv[1]} != "run" ||
+      std::string_view{argv[2]}.starts_with("--"))
+    return std::nullopt;
+  const auto address = make_address(socket_path);
+  if (!address)
+    return std::nullopt;
+  auto file = std::ifstream{argv[2], std::ios::binary};
+  if (!file)
+    return std::nullopt;
+  auto contents = std::ostringstream{};
+  contents << file.rdbuf();
+  const auto source = std::move(contents).str();
+
+  const auto fd = connect_to(*address);
+  if (fd < 0)
+    return std::nullopt;
+  defer { ::close(fd); };
+  auto message = std::string{};
+  put_u32(message, static_cast<std::uint32_t>(argc - 1));
+  for (auto i = 1; i < argc; ++i)
+    put_field(message, argv[i]);
+  put_field(message, source);
+  if (!write_all(fd, message))
+    return std::nullopt;
+  // running a script has no effect but its output, so if the server goes
+  // away before answering, the script can as well run here.
+  const auto exit_code = read_u32(fd);
+  auto out = exit_code ? read_field(fd) : std::nullopt;
+  auto err = out ? read_field(fd) : std::nullopt;
+  if (!err)
+    return std::nullopt;
+  std::fwrite(out->data(), 1, out->size(), stdout);
+  std::fwrite(err->data(), 1, err->size(), stderr);
+  return static_cast<int>(*exit_code);
+}
+#else
+int loxo_serve(ExecutionContext &) {
+  std::println(stderr, "serve needs Unix domain sockets.");
+  return 1;
+}
+std::optional<int> loxo_forward(int, char **, const char *) {
+  return std::nullopt;
+}
+#endif
+} // namespace net::ancillarycat::loxo
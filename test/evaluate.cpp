@@ -1,8 +1,17 @@
 #include <gtest/gtest.h>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <net/ancillarycat/utils/format.hpp>
 #include "test_env.hpp"
+#include "Evaluatable.hpp"
 
 namespace {
+namespace utils = net::ancillarycat::utils;
+
 auto get_result(const auto &filepath) {
   ExecutionContext ec;
   ec.commands.push_back(ExecutionContext::evaluate);
@@ -12,6 +21,17 @@ auto get_result(const auto &filepath) {
                                ec.error_stream.str() + ec.output_stream.str())
               : std::make_pair(exec, ec.output_stream.str());
 }
+/// @brief interpret @p source from a file of its own.
+auto interpret(const std::string &name, const std::string &source) {
+  const auto file = temp_directory_path() / (name + ".lox");
+  std::ofstream{file, std::ios::binary} << source;
+  ExecutionContext ec;
+  ec.commands.push_back(ExecutionContext::interpret);
+  ec.input_files.push_back(file);
+  auto exec = loxo_main(3, nullptr, ec);
+  remove(file);
+  return std::make_pair(exec, ec.output_stream.str() + ec.error_stream.str());
+}
 } // namespace
 TEST(add, integer) {
   auto [callback, str] = get_result("Z:/loxo/examples/eval/add1.lox");
@@ -48,3 +68,178 @@ TEST(math, intermediate) {
   EXPECT_EQ(str, "75\n");
   EXPECT_EQ(callback, 0);
 }
+
+TEST(string, intern_after_release) {
+  using evaluation::String;
+  const auto kept = String::intern("kept");
+  {
+    const auto gone = String::intern("gone");
+    EXPECT_TRUE((gone == String::intern("gone")).is_true());
+  }
+  // "gone" was dropped from the table along with its last string; interning
+  // it again makes the new canonical string.
+  const auto again = String::intern("gone");
+  EXPECT_TRUE((again == String::intern("gone")).is_true());
+  EXPECT_FALSE((again == kept).is_true());
+  EXPECT_TRUE((again == String{std::string{"gone"}}).is_true());
+  EXPECT_TRUE((kept == String::intern("kept")).is_true());
+}
+
+TEST(string, rope_append_loop) {
+  using evaluation::String;
+  constexpr auto appends = 100'000;
+  const auto piece = String{std::string{"ab"}};
+  auto rope = String{std::string{}};
+  auto flat = std::string{};
+  for (auto i = 0; i < appends; ++i) {
+    rope = rope + piece;
+    flat += "ab";
+  }
+  EXPECT_EQ(rope.size(), flat.size());
+  EXPECT_TRUE((rope == String{flat}).is_true());
+  EXPECT_FALSE((rope == String{flat + "a"}).is_true());
+  EXPECT_EQ(rope.to_string(), flat);
+  {
+    // dropped without ever being flattened: the deepest tree to destroy.
+    auto unread = String{std::string{}};
+    for (auto i = 0; i < appends; ++i)
+      unread = unread + piece;
+  }
+}
+
+TEST(string, rope_append_script) {
+  auto [callback, str] = interpret("loxo_rope_append",
+                                   "var s = \"\";\n"
+                                   "for (var i = 0; i < 100000; i = i + 1)\n"
+                                   "  s = s + \"ab\";\n"
+                                   "print s;\n"
+                                   "var t = s;\n"
+                                   "print s == t + \"\";\n"
+                                   "s = nil;\n"
+                                   "t = nil;\n"
+                                   "print \"done\";\n");
+  auto expected = std::string{};
+  for (auto i = 0; i < 100'000; ++i)
+    expected += "ab";
+  EXPECT_EQ(str, expected + "\ntrue\ndone\n");
+  EXPECT_EQ(callback, 0);
+}
+
+TEST(number, integer_fast_path) {
+  // the expected text is what plain `long double` arithmetic printed, which
+  // is just `double` on some platforms.
+  constexpr auto extended = std::numeric_limits<long double>::digits >= 64;
+  auto [callback, str] = interpret("loxo_number_integer",
+                                   "print 9007199254740992;\n"
+                                   "print 9007199254740992 + 1;\n"
+                                   "print -9007199254740992 - 1;\n"
+                                   "print 9007199254740991 + 1;\n"
+                                   "print 9007199254740992 * 2;\n"
+                                   "print 4294967296 * 4294967296;\n"
+                                   "print 123456789 * 987654321;\n"
+                                   "print 7 / 2;\n"
+                                   "print -7 / 2;\n"
+                                   "print 1 / 3;\n"
+                                   "print 10 / 5;\n"
+                                   "print -0;\n"
+                                   "print 0 * -1;\n"
+                                   "print 0 / -5;\n"
+                                   "print -0 + 0;\n");
+  EXPECT_EQ(str,
+            extended ? "9007199254740992\n"
+                       "9007199254740993\n"
+                       "-9007199254740993\n"
+                       "9007199254740992\n"
+                       "18014398509481984\n"
+                       "18446744073709551616\n"
+                       "121932631112635269\n"
+                       "3.5\n"
+                       "-3.5\n"
+                       "0.33333333333333333334\n"
+                       "2\n"
+                       "-0\n"
+                       "-0\n"
+                       "-0\n"
+                       "0\n"
+                     : "9007199254740992\n"
+                       "9007199254740992\n"
+                       "-9007199254740992\n"
+                       "9007199254740992\n"
+                       "18014398509481984\n"
+                       "18446744073709551616\n"
+                       "121932631112635264\n"
+                       "3.5\n"
+                       "-3.5\n"
+                       "0.3333333333333333\n"
+                       "2\n"
+                       "-0\n"
+                       "-0\n"
+                       "-0\n"
+                       "0\n");
+  EXPECT_EQ(callback, 0);
+}
+
+TEST(number, format) {
+  constexpr auto extended = std::numeric_limits<long double>::digits >= 64;
+  auto [callback, str] = interpret(
+      "loxo_number_format",
+      "print 1000000;\n"
+      "print 123456;\n"
+      "print 100000;\n"
+      "print 1000000000000000000000;\n"
+      "print 0.1 + 0.2;\n"
+      "print 0.000001;\n"
+      "print 0.0001;\n"
+      "print 2.5 * 4;\n"
+      "var big = 1000000000000000000000000000000;\n"
+      "var huge = big * big * big * big * big * big * big;\n"
+      "print huge;\n"
+      "print 1 / huge;\n");
+  EXPECT_EQ(str,
+            utils::format("1e+06\n"
+                          "123456\n"
+                          "1e+05\n"
+                          "1e+21\n"
+                          "{}\n"
+                          "1e-06\n"
+                          "1e-04\n"
+                          "10\n"
+                          "{}\n"
+                          "{}\n",
+                          extended ? "0.3" : "0.30000000000000004",
+                          extended ? "1.0000000000000000002e+210"
+                                   : "1.0000000000000004e+210",
+                          extended ? "9.9999999999999999985e-211"
+                                   : "9.999999999999997e-211"));
+  EXPECT_EQ(callback, 0);
+}
+
+TEST(number, integer_to_chars) {
+  // the integer fast path writes exactly what the floating-point one does.
+  constexpr auto max_integer = std::int64_t{1} << 53;
+  char integral[utils::kMaxNumberChars];
+  char real[utils::kMaxNumberChars];
+  const auto check = [&](const std::int64_t value) {
+    const auto lhs = std::string_view{
+        integral,
+        utils::number_to_chars(integral, integral + sizeof integral, value)};
+    const auto rhs = std::string_view{
+        real,
+        utils::number_to_chars(
+            real, real + sizeof real, static_cast<long double>(value))};
+    EXPECT_EQ(lhs, rhs) << value;
+    return lhs == rhs;
+  };
+  for (auto value = std::int64_t{-2'000'000}; value <= 2'000'000; ++value)
+    if (!check(value))
+      return;
+  // around every power of ten and the ends of the exact range.
+  for (auto power = std::int64_t{10}; power <= max_integer; power *= 10)
+    for (auto offset = std::int64_t{-1000}; offset <= 1000; ++offset)
+      if (!check(power + offset) || !check(-power - offset) ||
+          !check(power * (offset % 9 + 10) / 10))
+        return;
+  for (auto offset = std::int64_t{0}; offset <= 100'000; ++offset)
+    if (!check(max_integer - offset) || !check(-max_integer + offset))
+      return;
+}
@@ -1,8 +1,18 @@
 #include <gtest/gtest.h>
+#include <any>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <utility>
+#include <net/ancillarycat/utils/SmallVector.hpp>
 #include "test_env.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
 
 namespace {
+namespace utils = net::ancillarycat::utils;
+
 auto get_result(const auto &filepath) {
   ExecutionContext ec;
   ec.commands.push_back(ExecutionContext::interpret);
@@ -12,6 +22,23 @@ auto get_result(const auto &filepath) {
                                ec.output_stream.str() + ec.error_stream.str())
               : std::make_pair(exec, ec.output_stream.str());
 }
+/// @brief run @p source with the given function bodies; the lexer is gone
+/// before the first call, as it is in `serve`.
+auto run(const std::string &source, const parser::FunctionBodies bodies)
+    -> std::pair<utils::Status, std::string> {
+  auto ast = parser{};
+  {
+    auto scanner = lexer{};
+    EXPECT_TRUE(scanner.load(std::istringstream{source}).ok());
+    EXPECT_TRUE(scanner.lex().ok());
+    ast.set_views(scanner.get_tokens()).set_function_bodies(bodies);
+    if (auto res = ast.parse(parser::kStatement); !res)
+      return {res, {}};
+  }
+  auto interp = interpreter{};
+  auto res = interp.interpret(ast.get_statements());
+  return {res, interp.to_string()};
+}
 } // namespace
 TEST(function, native1) {
   const auto path = R"(Z:\loxo\examples\fn\native1.lox)";
@@ -115,3 +142,222 @@ TEST(function, closure2) {
             "\n4\n15\n15\nreset\nSecond:\n1\n6\n6\nSecond:\n2\n10\n10\n");
   EXPECT_EQ(callback, 0);
 }
+
+TEST(function, closure3) {
+  const auto path = R"(Z:\loxo\examples\fn\closure3.lox)";
+  auto [callback, str] = get_result(path);
+  EXPECT_EQ(str, "2\n0\n0\n");
+  EXPECT_EQ(callback, 0);
+}
+
+TEST(function, closure_outlives_frame) {
+  // `inc` caches where `i` lives on its first call, inside `mk`; later calls
+  // must follow the upvalue after `mk` has returned and it has closed.
+  const auto [res, output] = run(R"(
+fun mk() { var i = 0; fun inc() { i = i + 1; return i; } print inc(); return inc; }
+var c = mk();
+print c(); print c();
+var d = mk();
+print d(); print c();
+)",
+                                 parser::FunctionBodies::kEager);
+  EXPECT_TRUE(res.ok()) << res.message();
+  EXPECT_EQ(output, "1\n2\n3\n1\n2\n4\n");
+}
+
+TEST(function, binary_deoptimizes) {
+  // the `+` in `add` specializes on its first operands and has to fall back
+  // whenever they change type, until it stays generic for good.
+  const auto [res, output] = run(R"(
+fun add(a, b) { return a + b; }
+for (var i = 0; i < 3; i = i + 1) print add(i, 1);
+print add("a", "b");
+print add(2, 3);
+for (var i = 0; i < 8; i = i + 1) {
+  if (i < 4) print add(i, i); else print add("x", "y");
+  print add("z", "w");
+}
+print add(1, "b");
+print "unreachable";
+)",
+                                 parser::FunctionBodies::kEager);
+  EXPECT_FALSE(res.ok());
+  EXPECT_EQ(res.message(),
+            "Operands must be two numbers or two strings.\n[line 2]");
+  EXPECT_EQ(output,
+            "1\n2\n3\nab\n5\n"
+            "0\nzw\n2\nzw\n4\nzw\n6\nzw\n"
+            "xy\nzw\nxy\nzw\nxy\nzw\nxy\nzw\n");
+}
+
+TEST(function, recursive_closure_is_freed) {
+  // `fib` captures itself; once nothing refers to it, the upvalue holding it
+  // must not keep its closure environment alive.
+  auto closure_env = std::weak_ptr<Environment>{};
+  {
+    auto ast = parser{};
+    auto scanner = lexer{};
+    ASSERT_TRUE(scanner.load(std::istringstream{R"(
+var seed = 2;
+fun outer() {
+  var base = seed;
+  fun fib(n) { if (n < base) return n; return fib(n - 1) + fib(n - 2); }
+  return fib;
+}
+var f = outer();
+print f(10);
+)"}).ok());
+    ASSERT_TRUE(scanner.lex().ok());
+    ast.set_views(scanner.get_tokens());
+    ASSERT_TRUE(ast.parse(parser::kStatement).ok());
+    auto interp = interpreter{};
+    ASSERT_TRUE(interp.interpret(ast.get_statements()).ok());
+    EXPECT_EQ(interp.to_string(), "55\n");
+    const auto f = interp.get_global_env()->get("f");
+    ASSERT_TRUE(utils::holds_alternative<evaluation::Callable>(f));
+    closure_env = utils::get<evaluation::Callable>(f).environment();
+    ASSERT_FALSE(closure_env.expired());
+  }
+  EXPECT_TRUE(closure_env.expired());
+}
+
+TEST(function, many_arguments) {
+  // more than `kInlineArgs` arguments spill the inline buffer of the frame.
+  const auto [res, output] = run(R"(
+fun sum(a, b, c, d, e, f, g, h, i, j) {
+  return a + b + c + d + e + f + g + h + i + j;
+}
+print sum(1, 2, 3, 4, 5, 6, 7, 8, 9, 10);
+print sum("a", "b", "c", "d", "e", "f", "g", "h", "i", "j");
+)",
+                                 parser::FunctionBodies::kEager);
+  EXPECT_TRUE(res.ok()) << res.message();
+  EXPECT_EQ(output, "55\nabcdefghij\n");
+
+  const auto [too_many, many_output] = run(R"(
+fun sum(a, b, c, d, e, f, g, h, i, j) { return a; }
+print sum(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11);
+)",
+                                           parser::FunctionBodies::kEager);
+  EXPECT_FALSE(too_many.ok());
+  EXPECT_NE(too_many.message().find("expected 10 but got 11"),
+            std::string::npos)
+      << too_many.message();
+
+  const auto [too_few, few_output] = run(R"(
+fun sum(a, b, c, d, e, f, g, h, i, j) { return a; }
+print sum(1, 2, 3, 4, 5, 6, 7, 8, 9);
+)",
+                                         parser::FunctionBodies::kEager);
+  EXPECT_FALSE(too_few.ok());
+  EXPECT_NE(too_few.message().find("expected 10 but got 9"), std::string::npos)
+      << too_few.message();
+}
+
+TEST(function, argument_buffer_growth) {
+  // the element being appended may live in the buffer that is outgrown.
+  auto args = utils::SmallVector<std::string, 2>{};
+  args.push_back(std::string(32, 'a'));
+  args.push_back(std::string(32, 'b'));
+  args.push_back(args[0]);
+  args.push_back(args[1]);
+  ASSERT_EQ(args.size(), 4u);
+  EXPECT_FALSE(args.is_inline());
+  EXPECT_EQ(args[2], std::string(32, 'a'));
+  EXPECT_EQ(args[3], std::string(32, 'b'));
+}
+
+TEST(function, lazy_bodies) {
+  const auto source = std::string{R"(
+fun unused(a) { print a + "never"; { fun deeper() {} } }
+fun counter() {
+  var count = 0;
+  fun increment(step) { count = count + step; return count; }
+  return increment;
+}
+var shadowed = "outer";
+fun shadow() { var shadowed = "inner"; return shadowed; }
+var next = counter();
+print next(1); print next(2); print shadow(); print shadowed;
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(15);
+)"};
+  const auto [eager_res, eager] = run(source, parser::FunctionBodies::kEager);
+  ASSERT_TRUE(eager_res.ok()) << eager_res.message();
+  EXPECT_EQ(eager, "1\n3\ninner\nouter\n610\n");
+  for (const auto bodies : {parser::FunctionBodies::kLazy,
+                            parser::FunctionBodies::kLazyChecked}) {
+    const auto [res, output] = run(source, bodies);
+    EXPECT_TRUE(res.ok()) << res.message();
+    EXPECT_EQ(output, eager);
+  }
+}
+
+TEST(function, lazy_body_literals_outlive_parse) {
+  // long enough that the lexemes are not stored inline.
+  constexpr auto source =
+      "fun f() { print \"a string literal, not a short one\"; "
+      "print a_rather_long_variable_name; }\n"
+      "var a_rather_long_variable_name = 1;\n"
+      "f();\n";
+  auto ast = parser{};
+  {
+    auto scanner = lexer{};
+    ASSERT_TRUE(scanner.load(std::istringstream{source}).ok());
+    ASSERT_TRUE(scanner.lex().ok());
+    ast.set_views(scanner.get_tokens())
+        .set_function_bodies(parser::FunctionBodies::kLazy);
+    ASSERT_TRUE(ast.parse(parser::kStatement).ok());
+  }
+  auto interp = interpreter{};
+  ASSERT_TRUE(interp.interpret(ast.get_statements()).ok());
+  EXPECT_EQ(interp.to_string(), "a string literal, not a short one\n1\n");
+
+  // the body was parsed by the call; its tokens still read back.
+  const auto function =
+      std::dynamic_pointer_cast<statement::Function>(ast.get_statements()[0]);
+  ASSERT_TRUE(function && function->lazy_body &&
+              function->lazy_body->is_parsed());
+  const auto &statements = function->statements();
+  ASSERT_EQ(statements.size(), 2u);
+  const auto string = std::dynamic_pointer_cast<expression::Literal>(
+      std::dynamic_pointer_cast<statement::Print>(statements[0])->value);
+  ASSERT_TRUE(string);
+  EXPECT_EQ(std::any_cast<Token::string_view_type>(string->literal.literal),
+            "a string literal, not a short one"sv);
+  const auto variable = std::dynamic_pointer_cast<expression::Variable>(
+      std::dynamic_pointer_cast<statement::Print>(statements[1])->value);
+  ASSERT_TRUE(variable);
+  EXPECT_EQ(std::any_cast<Token::string_view_type>(variable->name.literal),
+            "a_rather_long_variable_name"sv);
+}
+
+TEST(function, lazy_body_errors) {
+  const auto broken =
+      std::string{"fun f() { print ; }\nprint \"before\";\nf();\n"};
+  const auto [eager_res, eager] = run(broken, parser::FunctionBodies::kEager);
+  EXPECT_EQ(eager_res.code(), utils::Status::kParseError);
+
+  // checked: reported up front, just like eager.
+  const auto [checked_res, checked] =
+      run(broken, parser::FunctionBodies::kLazyChecked);
+  EXPECT_EQ(checked_res.code(), utils::Status::kParseError);
+  EXPECT_EQ(checked_res.message(), eager_res.message());
+
+  // lazy: reported by the first call, with the same message.
+  const auto [lazy_res, lazy] = run(broken, parser::FunctionBodies::kLazy);
+  EXPECT_EQ(lazy_res.code(), utils::Status::kParseError);
+  EXPECT_EQ(lazy_res.message(), eager_res.message());
+  EXPECT_EQ(lazy, "before\n");
+
+  // never called, never reported.
+  const auto [unused_res, unused] =
+      run("fun f() { print ; }\nprint 1;\n", parser::FunctionBodies::kLazy);
+  EXPECT_TRUE(unused_res.ok());
+  EXPECT_EQ(unused, "1\n");
+
+  // the braces are still matched up front.
+  const auto [unclosed_res, unclosed] =
+      run("fun f() { { print 1; }\n", parser::FunctionBodies::kLazy);
+  EXPECT_EQ(unclosed_res.code(), utils::Status::kParseError);
+}
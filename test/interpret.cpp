@@ -1,5 +1,15 @@
 #include <gtest/gtest.h>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <net/ancillarycat/utils/json.hpp>
 #include "test_env.hpp"
+#include "Tracer.hpp"
 
 namespace {
 auto get_result(const auto &filepath) {
@@ -11,7 +21,26 @@ auto get_result(const auto &filepath) {
                                ec.output_stream.str() + ec.error_stream.str())
               : std::make_pair(exec, ec.output_stream.str());
 }
+/// @brief a file named @p name holding a script that calls `fib`, declared
+/// on line 1, recursively.
+auto fib_script(const std::string &name, const int n) {
+  const auto file = temp_directory_path() / (name + ".lox");
+  std::ofstream{file, std::ios::binary}
+      << "fun fib(n) {\n"
+         "  if (n < 2) return n;\n"
+         "  return fib(n - 1) + fib(n - 2);\n"
+         "}\n"
+         "print fib("
+      << n << ");\n";
+  return file;
+}
+auto read_file(const path &file) {
+  auto stream = std::ostringstream{};
+  stream << std::ifstream{file, std::ios::binary}.rdbuf();
+  return stream.str();
+}
 } // namespace
+namespace json = net::ancillarycat::utils::json;
 
 TEST(interpret, print) {
   const auto path = R"(Z:\loxo\examples\interp\stmt1.lox)";
@@ -164,3 +193,119 @@ TEST(interpret, scope4) {
   EXPECT_EQ(str, "[line 6] Error at '': Expect '}'.\n");
   EXPECT_EQ(callback, 65);
 }
+
+TEST(interpret, profile) {
+  // long enough for the sampler to catch `fib` many times over.
+  const auto script = fib_script("loxo_profile", 24);
+  const auto folded = temp_directory_path() / "loxo_profile.folded";
+  ExecutionContext ec;
+  ec.commands.push_back(ExecutionContext::interpret);
+  ec.input_files.push_back(script);
+  ec.profile_output = folded;
+  EXPECT_EQ(loxo_main(3, nullptr, ec), 0);
+  EXPECT_EQ(ec.output_stream.str(), "46368\n");
+  const auto stacks = read_file(folded);
+  remove(script);
+  remove(folded);
+  // `<script>;fib:1;fib:1 <count>` and so on, one stack per line.
+  EXPECT_NE(stacks.find("<script>;fib:1"), std::string::npos) << stacks;
+  auto lines = std::istringstream{stacks};
+  for (auto line = std::string{}; std::getline(lines, line);) {
+    EXPECT_TRUE(line.starts_with("<script>")) << line;
+    const auto count = line.substr(line.rfind(' ') + 1);
+    EXPECT_FALSE(count.empty()) << line;
+    EXPECT_EQ(count.find_first_not_of("0123456789"), std::string::npos)
+        << line;
+    for (auto frame = line.find(';'); frame != std::string::npos;
+         frame = line.find(';', frame + 1))
+      EXPECT_TRUE(line.compare(frame, 7, ";fib:1;") == 0 ||
+                  line.compare(frame, 7, ";fib:1 ") == 0)
+          << line;
+  }
+}
+
+TEST(interpret, counts) {
+  const auto script = fib_script("loxo_counts", 15);
+  ExecutionContext ec;
+  ec.commands.push_back(ExecutionContext::interpret);
+  ec.input_files.push_back(script);
+  ec.count_executions = true;
+  EXPECT_EQ(loxo_main(3, nullptr, ec), 0);
+  remove(script);
+  EXPECT_EQ(ec.output_stream.str(), "610\n");
+  // fib(n) calls itself 2 * fib(n + 1) - 1 times: 1973 for fib(15).
+  const auto table = ec.error_stream.str();
+  const auto row = "fib" + std::string(21, ' ') + std::string(7, ' ') + "1" +
+                   std::string(8, ' ') + "1973";
+  EXPECT_TRUE(table.starts_with("function")) << table;
+  EXPECT_NE(table.find("\n" + row + ' '), std::string::npos) << table;
+}
+
+TEST(interpret, trace) {
+  const auto script = fib_script("loxo_trace", 15);
+  const auto trace = temp_directory_path() / "loxo_trace.json";
+  ExecutionContext ec;
+  ec.commands.push_back(ExecutionContext::interpret);
+  ec.input_files.push_back(script);
+  ec.trace_output = trace;
+  EXPECT_EQ(loxo_main(3, nullptr, ec), 0);
+  EXPECT_EQ(ec.output_stream.str(), "610\n");
+  const auto text = read_file(trace);
+  remove(script);
+  remove(trace);
+
+  auto error = std::string{};
+  const auto document = json::parse(text, &error);
+  ASSERT_TRUE(document) << error;
+  const auto events = document->find("traceEvents");
+  ASSERT_TRUE(events && events->is_array());
+  auto names = std::set<std::string, std::less<>>{};
+  for (const auto &event : events->as_array()) {
+    const auto phase = event.find("ph");
+    ASSERT_TRUE(phase && phase->string());
+    if (*phase->string() != "X")
+      continue;
+    const auto name = event.find("name")->string();
+    ASSERT_TRUE(name);
+    names.emplace(*name);
+    EXPECT_TRUE(event.find("ts")->number());
+    EXPECT_GE(event.find("dur")->number().value_or(-1), 0);
+    const auto args = event.find("args");
+    const auto line = args ? args->find("line") : nullptr;
+    // a call is on the line `fib` was declared on.
+    if (*name == "fib")
+      EXPECT_EQ(line ? line->number() : std::nullopt, 1);
+    else if (*name == "statement")
+      EXPECT_TRUE(line && (line->number() == 1 || line->number() == 5));
+  }
+  for (const auto phase : {"lexer::lex", "parser::parse", "statement", "fib"})
+    EXPECT_TRUE(names.contains(phase)) << phase;
+}
+
+TEST(interpret, trace_span_outlives_tracer) {
+  using namespace std::chrono_literals;
+  auto tracer = std::make_unique<Tracer>(Tracer::Options{.max_depth = 1});
+  ASSERT_TRUE(tracer->start().ok());
+  auto stale = std::optional<Tracer::Span>{};
+  stale.emplace("stale");
+  // ending the span must not touch the ring of the destroyed tracer.
+  tracer.reset();
+  stale.reset();
+
+  tracer = std::make_unique<Tracer>(Tracer::Options{.max_depth = 1});
+  ASSERT_TRUE(tracer->start().ok());
+  stale.emplace("before_restart");
+  tracer->stop();
+  stale.reset();
+  // a span still open at the restart does not count against the depth.
+  ASSERT_TRUE(tracer->start().ok());
+  {
+    const auto span = Tracer::Span{"after_restart"};
+    std::this_thread::sleep_for(1ms);
+  }
+  tracer->stop();
+  const auto text = tracer->to_json();
+  EXPECT_TRUE(json::parse(text)) << text;
+  EXPECT_EQ(text.find("before_restart"), std::string::npos) << text;
+  EXPECT_NE(text.find("after_restart"), std::string::npos) << text;
+}
@@ -10,6 +10,7 @@ def loxo_add_test(name, src):
         srcs = [
             src,
             "//shared:loxo_driver.cpp",
+            "//shared:loxo_server.cpp",
             "//shared:execution_context.hpp",
             "//shared:test_env.hpp"
         ],
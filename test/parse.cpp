@@ -1,7 +1,16 @@
+#include <fstream>
+#include <memory>
+#include <span>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <gtest/gtest.h>
 #include "test_env.hpp"
+#include "ASTLoader.hpp"
+#include "ASTWriter.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
 
 namespace {
 auto get_result(const auto &filepath) {
@@ -13,6 +22,16 @@ auto get_result(const auto &filepath) {
                                ec.error_stream.str() + ec.output_stream.str())
               : std::make_pair(exec, ec.output_stream.str());
 }
+auto run(const std::span<std::shared_ptr<statement::Stmt>> statements) {
+  auto interp = interpreter{};
+  EXPECT_TRUE(interp.interpret(statements).ok());
+  return interp.to_string();
+}
+constexpr auto program = R"(var greeting = "hi" + " \"there\"";
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+for (var i = 0; i < 3; i = i + 1) print fib(i + 5);
+var x; while (x == nil) { x = 0.25; } { print x * -2; }
+print greeting; print !nil and (1 >= 2 or clock() > 0);)";
 } // namespace
 TEST(parse, print) {
   auto [callback, str] = get_result("Z:/loxo/examples/parsing/true.lox");
@@ -25,3 +44,94 @@ TEST(parse, error) {
   EXPECT_EQ(str, "[line 1] Error at ')': Expect expression.\n");
   EXPECT_EQ(callback, 65);
 }
+
+TEST(parse, ast_round_trip) {
+  auto scanner = lexer{};
+  ASSERT_TRUE(scanner.load(std::istringstream{program}).ok());
+  ASSERT_TRUE(scanner.lex().ok());
+  auto parsed = parser{};
+  parsed.set_views(scanner.get_tokens());
+  ASSERT_TRUE(parsed.parse(parser::kStatement).ok());
+  const auto expected = run(parsed.get_statements());
+
+  for (const auto format : {ASTWriter::Format::kBinary,
+                            ASTWriter::Format::kJson}) {
+    auto writer = ASTWriter{format};
+    ASSERT_TRUE(writer.write(parsed.get_statements()).ok());
+    const auto dumped = writer.take();
+    auto loader = ASTLoader{};
+    ASSERT_TRUE(loader.load(dumped).ok());
+    ASSERT_TRUE(writer.write(loader.get_statements()).ok());
+    EXPECT_EQ(writer.view(), dumped);
+    EXPECT_EQ(run(loader.get_statements()), expected);
+  }
+}
+
+TEST(parse, ast_loader_rejects_malformed) {
+  auto scanner = lexer{};
+  ASSERT_TRUE(scanner.load(std::istringstream{program}).ok());
+  ASSERT_TRUE(scanner.lex().ok());
+  auto parsed = parser{};
+  parsed.set_views(scanner.get_tokens());
+  ASSERT_TRUE(parsed.parse(parser::kStatement).ok());
+  auto writer = ASTWriter{ASTWriter::Format::kBinary};
+  ASSERT_TRUE(writer.write(parsed.get_statements()).ok());
+  const auto dumped = writer.take();
+
+  auto loader = ASTLoader{};
+  for (auto size = std::size_t{}; size < dumped.size(); ++size)
+    EXPECT_FALSE(loader.load(std::string_view{dumped}.substr(0, size)).ok());
+  EXPECT_TRUE(loader.get_statements().empty());
+  EXPECT_FALSE(loader.load("LXA\x02\x00"sv).ok());
+  EXPECT_FALSE(loader.load(R"({"format":"loxo-ast","version":1,"statements":[)"
+                           R"({"node":"Print","line":1,"value":null}]})")
+                   .ok());
+  EXPECT_FALSE(loader.load(R"({"format":"loxo-ast","version":1,"statements":[)"
+                           R"({"node":"Print","line":1,"value":{"node":)"
+                           R"("Literal","token":{"type":"PLUS","lexeme":"+",)"
+                           R"("line":1}}}]})")
+                   .ok());
+  EXPECT_TRUE(loader.load(R"({"format":"loxo-ast","version":1,)"
+                          R"("statements":[]})")
+                  .ok());
+}
+
+TEST(parse, ast_dump_of_broken_lazy_body) {
+  constexpr auto source = "fun ok() { return 1; }\n"
+                          "fun broken() { print ; }\n"
+                          "print ok();\n";
+  auto scanner = lexer{};
+  ASSERT_TRUE(scanner.load(std::istringstream{source}).ok());
+  ASSERT_TRUE(scanner.lex().ok());
+  auto parsed = parser{};
+  parsed.set_views(scanner.get_tokens())
+      .set_function_bodies(parser::FunctionBodies::kLazy);
+  ASSERT_TRUE(parsed.parse(parser::kStatement).ok());
+  for (const auto format : {ASTWriter::Format::kBinary,
+                            ASTWriter::Format::kJson}) {
+    auto writer = ASTWriter{format};
+    const auto res = writer.write(parsed.get_statements());
+    EXPECT_FALSE(res.ok());
+    EXPECT_NE(res.message().find("Expect expression."), std::string::npos)
+        << res.message();
+    EXPECT_TRUE(writer.view().empty());
+  }
+
+  // `parse --format=bin|json --lazy-functions` fails the same way.
+  const auto file = temp_directory_path() / "loxo_broken_lazy_body.lox";
+  std::ofstream{file, std::ios::binary} << source;
+  for (const auto format : {ExecutionContext::ast_format_t::binary,
+                            ExecutionContext::ast_format_t::json}) {
+    ExecutionContext ec;
+    ec.commands.push_back(ExecutionContext::parse);
+    ec.input_files.push_back(file);
+    ec.ast_format = format;
+    ec.function_bodies = ExecutionContext::function_bodies_t::lazy;
+    EXPECT_EQ(loxo_main(3, nullptr, ec), 65);
+    EXPECT_EQ(ec.output_stream.str(), "");
+    EXPECT_NE(ec.error_stream.str().find("Expect expression."),
+              std::string::npos)
+        << ec.error_stream.str();
+  }
+  remove(file);
+}
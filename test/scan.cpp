@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+#include <string>
 #include "test_env.hpp"
+#include "lexer.hpp"
+#include "Token.hpp"
+#include "TokenWriter.hpp"
 
 auto get_result(const auto &filepath) {
   std::ostringstream oss;
@@ -60,3 +66,61 @@ TEST(scan, simple3) {
             "RIGHT_PAREN ) null\n"
             "EOF  null\n");
 }
+
+TEST(scan, token_writer) {
+  auto scanner = lexer{};
+  ASSERT_TRUE(scanner
+                  .load(std::istringstream{
+                      "var s = \"lox\"; // comment\n"
+                      "fun f(a, b) { return a >= 4.5 or !nil; } @ 42 f(1);"})
+                  .ok());
+  ASSERT_TRUE(scanner.lex().ok());
+  const auto expected = "VAR var null\n"
+                        "IDENTIFIER s null\n"
+                        "EQUAL = null\n"
+                        "STRING \"lox\" lox\n"
+                        "SEMICOLON ; null\n"
+                        "FUN fun null\n"
+                        "IDENTIFIER f null\n"
+                        "LEFT_PAREN ( null\n"
+                        "IDENTIFIER a null\n"
+                        "COMMA , null\n"
+                        "IDENTIFIER b null\n"
+                        "RIGHT_PAREN ) null\n"
+                        "LEFT_BRACE { null\n"
+                        "RETURN return null\n"
+                        "IDENTIFIER a null\n"
+                        "GREATER_EQUAL >= null\n"
+                        "NUMBER 4.5 4.5\n"
+                        "OR or null\n"
+                        "BANG ! null\n"
+                        "NIL nil null\n"
+                        "SEMICOLON ; null\n"
+                        "RIGHT_BRACE } null\n"
+                        "[line 2] Error: Unexpected character: @\n"
+                        "NUMBER 42 42.0\n"
+                        "IDENTIFIER f null\n"
+                        "LEFT_PAREN ( null\n"
+                        "NUMBER 1 1.0\n"
+                        "RIGHT_PAREN ) null\n"
+                        "SEMICOLON ; null\n"
+                        "EOF  null\n"sv;
+
+  const auto file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  {
+#ifdef _WIN32
+    auto writer = TokenWriter{_fileno(file)};
+#else
+    auto writer = TokenWriter{fileno(file)};
+#endif
+    for (const auto &token : scanner.get_tokens())
+      writer.write(token);
+    EXPECT_TRUE(writer.flush().ok());
+  }
+  std::rewind(file);
+  auto written = std::string(expected.size() + 1, '\0');
+  written.resize(std::fread(written.data(), 1, written.size(), file));
+  std::fclose(file);
+  EXPECT_EQ(written, expected);
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#if !defined(_WIN32)
+#  include <array>
+#  include <chrono>
+#  include <csignal>
+#  include <fstream>
+#  include <optional>
+#  include <string>
+#  include <thread>
+#  include <unistd.h>
+#endif
+#include "test_env.hpp"
+
+#if !defined(_WIN32)
+namespace {
+struct Answer {
+  int exit_code = 0;
+  std::string out;
+  std::string err;
+};
+
+/// @brief a `serve` on a socket of its own, stopped the way a user would.
+class serve : public testing::Test {
+protected:
+  void SetUp() override {
+    my_dir = temp_directory_path() /
+             ("loxo_serve_test_" + std::to_string(::getpid()));
+    create_directories(my_dir);
+    my_socket = my_dir / "loxo.sock";
+    my_server = std::thread{[this] {
+      auto ctx = ExecutionContext{};
+      ctx.commands.push_back(ExecutionContext::serve);
+      ctx.input_files.push_back(my_socket);
+      ctx.workers = 2;
+      my_server_exit_code = loxo_serve(ctx);
+    }};
+    // the first answer also means the stop signals are handled by now.
+    const auto probe = script("probe", "");
+    for (auto attempts = 0; attempts < 500 && !my_ready; ++attempts) {
+      if (forward(probe))
+        my_ready = true;
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+  }
+  void TearDown() override {
+    if (my_ready)
+      std::raise(SIGTERM);
+    my_server.join();
+    EXPECT_EQ(my_server_exit_code, 0);
+    remove_all(my_dir);
+  }
+
+  auto script(const std::string &name, const std::string &source) const
+      -> path {
+    auto file = my_dir / (name + ".lox");
+    std::ofstream{file, std::ios::binary} << source;
+    return file;
+  }
+  /// @brief `interpreter run <file>` with `LOXO_SOCKET` set.
+  auto forward(const path &file) const -> std::optional<Answer> {
+    auto args = std::array<std::string, 3>{"interpreter", "run", file.string()};
+    char *argv[] = {args[0].data(), args[1].data(), args[2].data(), nullptr};
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    const auto exit_code = loxo_forward(3, argv, my_socket.c_str());
+    auto out = testing::internal::GetCapturedStdout();
+    auto err = testing::internal::GetCapturedStderr();
+    if (!exit_code)
+      return std::nullopt;
+    return Answer{*exit_code, std::move(out), std::move(err)};
+  }
+
+  bool my_ready = false;
+
+private:
+  path my_dir;
+  path my_socket;
+  std::thread my_server;
+  int my_server_exit_code = -1;
+};
+} // namespace
+
+TEST_F(serve, run_twice) {
+  ASSERT_TRUE(my_ready);
+  // the second request of each script is answered from the cache, with a
+  // parsed copy that already ran once.
+  const auto ok = script("ok",
+                         "var count = 0;\n"
+                         "fun bump() { count = count + 1; return count; }\n"
+                         "print bump();\n"
+                         "print bump();\n");
+  const auto parse_error = script("parse_error", "print ;\n");
+  const auto runtime_error =
+      script("runtime_error", "print \"before\";\nprint 1 + true;\n");
+  for (auto i = 0; i < 2; ++i) {
+    const auto answer = forward(ok);
+    ASSERT_TRUE(answer);
+    EXPECT_EQ(answer->exit_code, 0);
+    EXPECT_EQ(answer->out, "1\n2\n\n");
+    EXPECT_EQ(answer->err, "");
+
+    const auto failed_parse = forward(parse_error);
+    ASSERT_TRUE(failed_parse);
+    EXPECT_EQ(failed_parse->exit_code, 65);
+    EXPECT_EQ(failed_parse->out, "");
+    EXPECT_NE(failed_parse->err.find("Expect expression."), std::string::npos);
+
+    const auto failed_run = forward(runtime_error);
+    ASSERT_TRUE(failed_run);
+    EXPECT_EQ(failed_run->exit_code, 70);
+    EXPECT_EQ(failed_run->out, "before\n");
+    EXPECT_NE(
+        failed_run->err.find("Operands must be two numbers or two strings."),
+        std::string::npos);
+  }
+}
+#endif
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "test_env.hpp"
+#include "Session.hpp"
+
+TEST(session, globals_persist) {
+  auto session = Session{};
+  EXPECT_TRUE(session.feed("var persist_a = 40;").ok());
+  EXPECT_EQ(session.take_output(), "");
+  EXPECT_TRUE(session.feed("var persist_b = persist_a + 1;").ok());
+  EXPECT_TRUE(session.feed("print persist_b + 1;").ok());
+  EXPECT_EQ(session.take_output(), "42\n");
+  EXPECT_TRUE(session.feed("print persist_a;").ok());
+  EXPECT_EQ(session.take_output(), "40\n");
+}
+
+TEST(session, globals_are_isolated) {
+  auto first = Session{};
+  auto second = Session{};
+  EXPECT_TRUE(first.feed("var isolated = 1;").ok());
+  EXPECT_FALSE(second.feed("print isolated;").ok());
+  EXPECT_TRUE(second.feed("print clock() > 0;").ok());
+  EXPECT_EQ(second.take_output(), "true\n");
+}
+
+TEST(session, multiline_function) {
+  auto session = Session{};
+  EXPECT_TRUE(session.feed("fun multiline_add(a, b) {").ok());
+  EXPECT_EQ(session.state(), Session::State::kIncomplete);
+  EXPECT_TRUE(session.feed("  return a + b;").ok());
+  EXPECT_EQ(session.state(), Session::State::kIncomplete);
+  EXPECT_TRUE(session.feed("}").ok());
+  EXPECT_EQ(session.state(), Session::State::kIdle);
+  EXPECT_TRUE(session.feed("print multiline_add(1, 2);").ok());
+  EXPECT_EQ(session.take_output(), "3\n");
+}
+
+TEST(session, blank_lines_and_comments) {
+  auto session = Session{};
+  EXPECT_TRUE(session.feed("").ok());
+  EXPECT_TRUE(session.feed("  // nothing to see here { (").ok());
+  EXPECT_EQ(session.state(), Session::State::kIdle);
+  EXPECT_TRUE(session.feed("var blank_a = \"{(\"; // }").ok());
+  EXPECT_EQ(session.state(), Session::State::kIdle);
+  EXPECT_TRUE(session.feed("print blank_a;").ok());
+  EXPECT_EQ(session.take_output(), "{(\n");
+  EXPECT_EQ(session.line(), 5u);
+}
+
+TEST(session, multiline_string) {
+  auto session = Session{};
+  EXPECT_TRUE(session.feed("var multiline_s = \"first").ok());
+  EXPECT_EQ(session.state(), Session::State::kIncomplete);
+  EXPECT_TRUE(session.feed("second\";").ok());
+  EXPECT_TRUE(session.feed("print multiline_s;").ok());
+  EXPECT_EQ(session.take_output(), "first\nsecond\n");
+}
+
+TEST(session, error_does_not_end_session) {
+  auto session = Session{};
+  EXPECT_TRUE(session.feed("var error_x = 1;").ok());
+  const auto res = session.feed("print error_x + true;");
+  EXPECT_FALSE(res.ok());
+  EXPECT_NE(res.message().find("[line 2]"), std::string::npos);
+  EXPECT_FALSE(session.feed("{ var error_y = 2; print error_y + nil; }").ok());
+  // back at the global scope after the error inside the block.
+  EXPECT_TRUE(session.feed("var error_y = 3;").ok());
+  EXPECT_TRUE(session.feed("print error_x + error_y;").ok());
+  EXPECT_EQ(session.take_output(), "4\n");
+}
+
+TEST(session, wait_for_else) {
+  auto session = Session{{.wait_for_else = true}};
+  EXPECT_TRUE(session.feed("if (false) print 1;").ok());
+  EXPECT_EQ(session.state(), Session::State::kMaybeElse);
+  EXPECT_TRUE(session.feed("").ok());
+  EXPECT_TRUE(session.feed("else print 2;").ok());
+  EXPECT_EQ(session.take_output(), "");
+  EXPECT_TRUE(session.feed("print 3;").ok());
+  EXPECT_EQ(session.take_output(), "2\n3\n");
+  EXPECT_TRUE(session.feed("if (true) {").ok());
+  EXPECT_TRUE(session.feed("  print 4;").ok());
+  EXPECT_TRUE(session.feed("}").ok());
+  EXPECT_EQ(session.state(), Session::State::kMaybeElse);
+  EXPECT_TRUE(session.finish().ok());
+  EXPECT_EQ(session.take_output(), "4\n");
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cstddef>
+#include <cstdlib>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -45,6 +46,10 @@ void alterToolContext(accat::loxo::ExecutionContext &execution_context) {
 }
 // NOLINTNEXTLINE // <-- why clang-tidy warns the main function?
 int main(int argc, char **argv, char **envp) {
+  // a thin client if a `serve` process is around; see loxo_server.cpp.
+  if (const auto socket = std::getenv("LOXO_SOCKET"))
+    if (const auto exit_code = accat::loxo::loxo_forward(argc, argv, socket))
+      return *exit_code;
 
   auto &tool_context =
       accat::loxo::ExecutionContext::inspectArgs(argc, argv, envp);